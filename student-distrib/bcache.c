@@ -0,0 +1,153 @@
+/* bcache.c
+ * Write back cache of disk blocks. Changes stay in the cache until the block is
+ * evicted or bcache_sync() runs. Buffers are pinned while in use so a page fault
+ * that reads a file in the middle of a copy can't evict the block being copied.
+ */
+
+#include "bcache.h"
+#include "lib.h"
+
+uint8_t bcache_data[BCACHE_SIZE][FS_BLOCK_SIZE] __attribute__((aligned (FS_BLOCK_SIZE)));
+bcache_buf_t bcache[BCACHE_SIZE];
+
+// Bumped on every get, the unpinned buffer with the smallest last_use is evicted first
+uint32_t bcache_clock = 0;
+
+uint32_t bcache_hits = 0;
+uint32_t bcache_misses = 0;
+uint32_t bcache_writebacks = 0;
+
+/* bcache_init()
+ * Input: none
+ * Return: none
+ * Effect: empties the cache
+ */
+void bcache_init(void) {
+	uint32_t i;
+
+	for(i = 0; i < BCACHE_SIZE; i++) {
+		bcache[i].valid = 0;
+		bcache[i].dirty = 0;
+		bcache[i].pins = 0;
+		bcache[i].last_use = 0;
+		bcache[i].data = bcache_data[i];
+	}
+}
+
+/* bcache_writeback()
+ * Input: buffer
+ * Return: none
+ * Effect: writes a dirty buffer to the disk
+ */
+static void bcache_writeback(bcache_buf_t* buf) {
+	if(buf->valid && buf->dirty) {
+		ramdisk_write(buf->block, buf->data);
+		buf->dirty = 0;
+		bcache_writebacks++;
+	}
+}
+
+/* bcache_get()
+ * Input: disk block number, 1 to read the block in on a miss, 0 if the caller
+ *			overwrites the whole block anyway
+ * Return: pinned buffer holding the block, NULL if every buffer is pinned or the
+ *			block is past the end of the disk
+ * Effect: may evict and write back the least recently used buffer
+ */
+bcache_buf_t* bcache_get(uint32_t block, uint32_t read) {
+	uint32_t i, flags;
+	bcache_buf_t* buf = NULL;
+
+	if(block >= ramdisk_blocks())
+		return NULL;
+
+	cli_and_save(flags);
+	bcache_clock++;
+	for(i = 0; i < BCACHE_SIZE; i++) {
+		if(bcache[i].valid && bcache[i].block == block) {
+			bcache_hits++;
+			bcache[i].pins++;
+			bcache[i].last_use = bcache_clock;
+			restore_flags(flags);
+			return &bcache[i];
+		}
+	}
+	bcache_misses++;
+
+	for(i = 0; i < BCACHE_SIZE; i++) {
+		if(bcache[i].pins)
+			continue;
+		if(!bcache[i].valid) {
+			buf = &bcache[i];
+			break;
+		}
+		if((buf == NULL) || (bcache[i].last_use < buf->last_use))
+			buf = &bcache[i];
+	}
+	if(buf == NULL) {
+		restore_flags(flags);
+		return NULL;
+	}
+
+	bcache_writeback(buf);
+	buf->valid = 1;
+	buf->block = block;
+	buf->pins = 1;
+	buf->last_use = bcache_clock;
+	if(read)
+		ramdisk_read(block, buf->data);
+	restore_flags(flags);
+	return buf;
+}
+
+/* bcache_put()
+ * Input: buffer from bcache_get
+ * Return: none
+ * Effect: unpins the buffer
+ */
+void bcache_put(bcache_buf_t* buf) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if(buf->pins)
+		buf->pins--;
+	restore_flags(flags);
+}
+
+/* bcache_mark_dirty()
+ * Input: pinned buffer
+ * Return: none
+ * Effect: the buffer is written back before it leaves the cache
+ */
+void bcache_mark_dirty(bcache_buf_t* buf) {
+	buf->dirty = 1;
+}
+
+/* bcache_sync()
+ * Input: none
+ * Return: none
+ * Effect: writes every dirty buffer back, they stay cached
+ */
+void bcache_sync(void) {
+	uint32_t i, flags;
+
+	cli_and_save(flags);
+	for(i = 0; i < BCACHE_SIZE; i++)
+		bcache_writeback(&bcache[i]);
+	restore_flags(flags);
+}
+
+/* bcache_dirty_count()
+ * Input: none
+ * Return: number of buffers waiting to be written back
+ * Effect: none
+ */
+uint32_t bcache_dirty_count(void) {
+	uint32_t i, count = 0;
+
+	for(i = 0; i < BCACHE_SIZE; i++) {
+		if(bcache[i].valid && bcache[i].dirty)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,33 @@
+/* bcache.h
+ */
+
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+#include "types.h"
+#include "ramdisk.h"
+
+#define BCACHE_SIZE 32
+
+// One cached disk block
+typedef struct bcache_buf_t {
+	uint32_t valid;
+	uint32_t block;				//disk block number
+	uint32_t dirty;				//changed since it was read, written back on eviction or sync
+	uint32_t pins;				//users between bcache_get and bcache_put, never evicted while pinned
+	uint32_t last_use;
+	uint8_t* data;
+} bcache_buf_t;
+
+void bcache_init(void);
+bcache_buf_t* bcache_get(uint32_t block, uint32_t read);
+void bcache_put(bcache_buf_t* buf);
+void bcache_mark_dirty(bcache_buf_t* buf);
+void bcache_sync(void);
+uint32_t bcache_dirty_count(void);
+
+extern uint32_t bcache_hits;
+extern uint32_t bcache_misses;
+extern uint32_t bcache_writebacks;
+
+#endif /* _BCACHE_H */
@@ -0,0 +1,186 @@
+/* exe_cache.c
+ * Keeps the last few executables loaded in frames so execute and spawn can share
+ * them copy on write instead of reading the file again. The cache holds one
+ * reference to every image frame, so a task writing a page gets its own copy and
+ * the cached image stays clean.
+ */
+
+#include "exe_cache.h"
+#include "system_call.h"
+#include "fs_module.h"
+#include "paging.h"
+#include "frame.h"
+#include "lib.h"
+
+exe_image_t exe_cache[EXE_CACHE_SIZE];
+
+// Bumped on every lookup, the entry with the smallest last_use is evicted first
+uint32_t exe_cache_clock = 0;
+
+uint32_t exe_cache_hits = 0;
+uint32_t exe_cache_misses = 0;
+
+/* exe_image_drop()
+ * Input: cache entry
+ * Return: none
+ * Effect: gives the entry's frames back, tasks still using them keep their references
+ */
+static void exe_image_drop(exe_image_t* image) {
+	if(image->pages != NULL) {
+		user_pages_free(image->pages);
+		frame_free((uint32_t)image->pages);
+		image->pages = NULL;
+	}
+	image->valid = 0;
+}
+
+/* exe_image_load()
+ * Input: cache entry with inode and length filled in
+ * Return: none
+ * Effect: reads the program into fresh frames laid out like the program page,
+ *			leaves pages NULL if memory runs out so the task falls back to demand paging
+ */
+static void exe_image_load(exe_image_t* image) {
+	uint32_t page, frame, start, end;
+
+	image->pages = (uint32_t*)frame_alloc();
+	if(image->pages == NULL)
+		return;
+	user_pages_init(image->pages);
+
+	for(page = (program_addr - virtual_mem) / fourK; virtual_mem + page * fourK < program_addr + image->length; page++) {
+		frame = frame_alloc();
+		if(frame == 0) {
+			exe_image_drop(image);
+			return;
+		}
+		// Frames are identity mapped, the same split as demand_page() but into the frame
+		memset((void*)frame, 0, fourK);
+		start = virtual_mem + page * fourK;
+		end = start + fourK;
+		if(start < program_addr)
+			start = program_addr;
+		if(end > program_addr + image->length)
+			end = program_addr + image->length;
+		read_data(image->inode, start - program_addr, (char*)(frame + (start & (fourK - 1))), end - start);
+		image->pages[page] = frame | PAGE_COW | 0x5;	// user_level, read only, present
+	}
+}
+
+/* exe_cache_lookup()
+ * Input: inode of the program, image to fill in if every cache entry is pinned
+ * Return: the image pinned until exe_cache_put(), NULL if the file isn't an executable
+ * Effect: On a miss checks the ELF magic, reads the entry point and loads the
+ *			image into the least recently used unpinned entry. The file is read
+ *			with interrupts on, the entry is pinned and invisible to other
+ *			lookups meanwhile. With no entry to spare, spare comes back without
+ *			pages and the task is demand paged.
+ */
+exe_image_t* exe_cache_lookup(uint32_t inode, exe_image_t* spare) {
+	uint32_t i, flags, eip;
+	char buf[4];		  // need 4 bytes to check the ELF magic
+	exe_image_t* image = NULL;
+
+	cli_and_save(flags);
+	exe_cache_clock++;
+	for(i = 0; i < EXE_CACHE_SIZE; i++) {
+		if(exe_cache[i].valid && exe_cache[i].inode == inode) {
+			exe_cache_hits++;
+			exe_cache[i].last_use = exe_cache_clock;
+			exe_cache[i].pins++;
+			restore_flags(flags);
+			return &exe_cache[i];
+		}
+	}
+	exe_cache_misses++;
+	restore_flags(flags);
+
+	// Check the file is an ELF before it takes a slot
+	if((read_data(inode, 0, buf, 4) != 4) || (buf[0] != ELF_CHECK0) || (buf[1] != ELF_CHECK1) || (buf[2] != ELF_CHECK2) || (buf[3] != ELF_CHECK3))
+		return NULL;
+	if(read_data(inode, eip_offset * 4, (char*)&eip, 4) != 4)
+		return NULL;
+
+	cli_and_save(flags);
+	for(i = 0; i < EXE_CACHE_SIZE; i++) {
+		if(exe_cache[i].pins != 0)
+			continue;
+		if(!exe_cache[i].valid) {
+			image = &exe_cache[i];
+			break;
+		}
+		if((image == NULL) || (exe_cache[i].last_use < image->last_use))
+			image = &exe_cache[i];
+	}
+	if(image == NULL) {
+		restore_flags(flags);
+		image = spare;
+		image->pages = NULL;
+	} else {
+		exe_image_drop(image);
+		image->inode = inode;
+		image->pins = 1;
+		image->stale = 0;
+		restore_flags(flags);
+	}
+
+	image->inode = inode;
+	image->eip = eip;
+	image->length = inode_length(inode);
+	if(image->length > twoM)
+		image->length = twoM;
+	image->last_use = exe_cache_clock;
+	if(image == spare)
+		return image;
+	exe_image_load(image);
+
+	// Other lookups see the entry from now on, unless the file changed while loading
+	cli_and_save(flags);
+	if(!image->stale)
+		image->valid = 1;
+	restore_flags(flags);
+	return image;
+}
+
+/* exe_cache_put()
+ * Input: image from exe_cache_lookup()
+ * Return: none
+ * Effect: Unpins the image once its pages are shared with the new task. An
+ *			entry invalidated while pinned is dropped by the last put.
+ */
+void exe_cache_put(exe_image_t* image) {
+	uint32_t flags;
+
+	if((image < exe_cache) || (image >= exe_cache + EXE_CACHE_SIZE))
+		return;
+	cli_and_save(flags);
+	image->pins--;
+	if((image->pins == 0) && image->stale) {
+		image->stale = 0;
+		exe_image_drop(image);
+	}
+	restore_flags(flags);
+}
+
+/* exe_cache_invalidate()
+ * Input: inode whose contents changed
+ * Return: none
+ * Effect: forgets the cached image of the inode, if any
+ */
+void exe_cache_invalidate(uint32_t inode) {
+	uint32_t i, flags;
+
+	cli_and_save(flags);
+	for(i = 0; i < EXE_CACHE_SIZE; i++) {
+		if(exe_cache[i].inode != inode)
+			continue;
+		// A task may be about to share a pinned image's frames, so drop it at the last put
+		if(exe_cache[i].pins != 0) {
+			exe_cache[i].valid = 0;
+			exe_cache[i].stale = 1;
+		} else if(exe_cache[i].valid) {
+			exe_image_drop(&exe_cache[i]);
+		}
+	}
+	restore_flags(flags);
+}
@@ -0,0 +1,31 @@
+/* exe_cache.h
+ */
+
+#ifndef _EXE_CACHE_H
+#define _EXE_CACHE_H
+
+#include "types.h"
+
+#define EXE_CACHE_SIZE 8
+
+// A program image ready to be handed to a new task
+typedef struct exe_image_t {
+	uint32_t valid;
+	uint32_t inode;
+	uint32_t eip;				//entry point, bytes 24-27 of the executable
+	uint32_t length;			//bytes of the file that land in the program page
+	uint32_t* pages;			//template program page table of read only copy on write
+								//frames, NULL if the image didn't fit in memory
+	uint32_t last_use;
+	uint32_t pins;				//lookups not yet put back, a pinned entry is never evicted
+	uint32_t stale;				//file changed while pinned, dropped at the last put
+} exe_image_t;
+
+exe_image_t* exe_cache_lookup(uint32_t inode, exe_image_t* spare);
+void exe_cache_put(exe_image_t* image);
+void exe_cache_invalidate(uint32_t inode);
+
+extern uint32_t exe_cache_hits;
+extern uint32_t exe_cache_misses;
+
+#endif /* _EXE_CACHE_H */
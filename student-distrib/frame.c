@@ -0,0 +1,250 @@
+/* frame.c
+ * Physical page frame allocator. One bit per 4kb frame between 8MB and 128MB,
+ * seeded from the multiboot memory map. Frames shared copy on write by fork keep
+ * a reference count and only go back to the pool with their last user. The whole pool is identity mapped for
+ * the kernel by paging_init, so frames can be used as soon as they are handed out.
+ */
+
+#include "frame.h"
+#include "lib.h"
+
+// Bit set means the frame is in use or not backed by ram
+uint8_t frame_bitmap[FRAME_COUNT / 8];
+// Users of each frame, 0 for free or reserved frames
+uint8_t frame_refs[FRAME_COUNT];
+// Number of free frames left
+uint32_t free_frames = 0;
+// Highest address of usable ram in the pool
+uint32_t pool_top = FRAME_POOL_START;
+// Where the next search starts, frames below it were in use last time we looked
+uint32_t frame_hint = 0;
+
+/* frame_mark()
+ * Input: first frame index, number of frames, 1 to mark used, 0 to mark free
+ * Return: none
+ * Effect: updates the bitmap and the free frame count
+ */
+static void frame_mark(uint32_t index, uint32_t count, uint32_t used) {
+	uint32_t i;
+
+	for(i = index; i < index + count && i < FRAME_COUNT; i++) {
+		if(used && !(frame_bitmap[i / 8] & (1 << (i % 8)))) {
+			frame_bitmap[i / 8] |= (1 << (i % 8));
+			free_frames--;
+		} else if(!used && (frame_bitmap[i / 8] & (1 << (i % 8)))) {
+			frame_bitmap[i / 8] &= ~(1 << (i % 8));
+			free_frames++;
+		}
+	}
+}
+
+/* frame_mark_region()
+ * Input: physical base and length of a region, 1 to mark used, 0 to mark free
+ * Return: none
+ * Effect: marks every frame of the pool the region covers; free regions only count
+ *			whole frames, used regions count any frame they touch
+ */
+static void frame_mark_region(uint32_t base, uint32_t length, uint32_t used) {
+	uint32_t start = base;
+	uint32_t end = base + length;
+
+	// Regions that wrap past 4GB end at 4GB
+	if(end < base)
+		end = 0xFFFFFFFF;
+
+	if(used) {
+		start = start & ~(FRAME_SIZE - 1);
+		end = (end + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+	} else {
+		start = (start + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+		end = end & ~(FRAME_SIZE - 1);
+	}
+
+	// Clip to the pool
+	if(start < FRAME_POOL_START)
+		start = FRAME_POOL_START;
+	if(end > FRAME_POOL_END)
+		end = FRAME_POOL_END;
+	if(start >= end)
+		return;
+
+	if(!used && end > pool_top)
+		pool_top = end;
+	frame_mark((start - FRAME_POOL_START) / FRAME_SIZE, (end - start) / FRAME_SIZE, used);
+}
+
+/* frame_init()
+ * Input: multiboot info from the boot loader
+ * Return: none
+ * Effect: frees the frames the memory map reports as usable ram, then takes the
+ *			boot modules back out. Falls back to mem_upper without a memory map.
+ */
+void frame_init(multiboot_info_t* mbi) {
+	memory_map_t* mmap;
+	module_t* mod;
+	uint32_t i;
+
+	// Start with nothing available
+	memset(frame_bitmap, 0xFF, sizeof(frame_bitmap));
+	free_frames = 0;
+
+	if(mbi->flags & (1 << 6)) {
+		for(mmap = (memory_map_t*)mbi->mmap_addr;
+				(uint32_t)mmap < mbi->mmap_addr + mbi->mmap_length;
+				mmap = (memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size))) {
+			// Ram above 4GB can't be used without PAE
+			if(mmap->type == MMAP_AVAILABLE && mmap->base_addr_high == 0)
+				frame_mark_region(mmap->base_addr_low, mmap->length_high ? 0xFFFFFFFF - mmap->base_addr_low : mmap->length_low, 0);
+		}
+	} else if(mbi->flags & 0x1) {
+		// mem_upper is the KB of ram starting at 1MB
+		frame_mark_region(0x100000, mbi->mem_upper * 1024, 0);
+	}
+
+	// Modules can be loaded anywhere, don't hand them out
+	if(mbi->flags & (1 << 3)) {
+		mod = (module_t*)mbi->mods_addr;
+		for(i = 0; i < mbi->mods_count; i++, mod++)
+			frame_mark_region(mod->mod_start, mod->mod_end - mod->mod_start, 1);
+	}
+	frame_hint = 0;
+}
+
+/* frame_alloc()
+ * Input: none
+ * Return: physical address of a free 4kb frame, 0 if memory is full
+ * Effect: marks the frame used
+ */
+uint32_t frame_alloc(void) {
+	return frames_alloc(1);
+}
+
+/* frames_alloc()
+ * Input: number of frames needed
+ * Return: physical address of count contiguous free frames, 0 if none are found
+ * Effect: marks the frames used, first fit starting at the search hint
+ */
+uint32_t frames_alloc(uint32_t count) {
+	uint32_t i, run, flags;
+	uint32_t start = 0;
+
+	if(count == 0)
+		return 0;
+
+	cli_and_save(flags);
+	run = 0;
+	for(i = frame_hint; i < FRAME_COUNT; i++) {
+		// Skip a full byte of used frames at once
+		if((i % 8) == 0 && frame_bitmap[i / 8] == 0xFF && i + 8 <= FRAME_COUNT) {
+			run = 0;
+			i += 7;
+			continue;
+		}
+		if(frame_bitmap[i / 8] & (1 << (i % 8))) {
+			run = 0;
+			continue;
+		}
+		if(run == 0)
+			start = i;
+		run++;
+		if(run == count) {
+			frame_mark(start, count, 1);
+			for(i = start; i < start + count; i++)
+				frame_refs[i] = 1;
+			// Only single frames keep the hint exact, everything below it is used
+			if(count == 1 || start == frame_hint)
+				frame_hint = start + count;
+			restore_flags(flags);
+			return FRAME_POOL_START + start * FRAME_SIZE;
+		}
+	}
+
+	// Nothing past the hint, look again from the start of the pool once
+	if(frame_hint != 0) {
+		frame_hint = 0;
+		restore_flags(flags);
+		return frames_alloc(count);
+	}
+	restore_flags(flags);
+	return 0;
+}
+
+/* frame_free()
+ * Input: physical address of a frame from frame_alloc
+ * Return: none
+ * Effect: drops one reference, the frame goes back to the pool with the last one
+ */
+void frame_free(uint32_t addr) {
+	frames_free(addr, 1);
+}
+
+/* frames_free()
+ * Input: physical address of frames from frames_alloc, number of frames
+ * Return: none
+ * Effect: drops one reference to each frame, unshared frames go back to the pool
+ */
+void frames_free(uint32_t addr, uint32_t count) {
+	uint32_t index, i, flags;
+
+	if(addr < FRAME_POOL_START || addr >= FRAME_POOL_END)
+		return;
+	index = (addr - FRAME_POOL_START) / FRAME_SIZE;
+
+	cli_and_save(flags);
+	for(i = index; i < index + count && i < FRAME_COUNT; i++) {
+		if(frame_refs[i] > 1) {
+			frame_refs[i]--;
+			continue;
+		}
+		frame_refs[i] = 0;
+		frame_mark(i, 1, 0);
+		if(i < frame_hint)
+			frame_hint = i;
+	}
+	restore_flags(flags);
+}
+
+/* frame_ref()
+ * Input: physical address of an allocated frame
+ * Return: none
+ * Effect: adds a user to the frame, it needs one more frame_free before it is freed
+ */
+void frame_ref(uint32_t addr) {
+	uint32_t flags;
+
+	if(addr < FRAME_POOL_START || addr >= FRAME_POOL_END)
+		return;
+
+	cli_and_save(flags);
+	frame_refs[(addr - FRAME_POOL_START) / FRAME_SIZE]++;
+	restore_flags(flags);
+}
+
+/* frame_refcount()
+ * Input: physical address of a frame
+ * Return: number of users of the frame, 0 if it is free or outside the pool
+ * Effect: none
+ */
+uint32_t frame_refcount(uint32_t addr) {
+	if(addr < FRAME_POOL_START || addr >= FRAME_POOL_END)
+		return 0;
+	return frame_refs[(addr - FRAME_POOL_START) / FRAME_SIZE];
+}
+
+/* frame_pool_top()
+ * Input: none
+ * Return: end of the usable ram in the pool
+ * Effect: none, paging_init identity maps the pool up to here
+ */
+uint32_t frame_pool_top(void) {
+	return pool_top;
+}
+
+/* frames_available()
+ * Input: none
+ * Return: number of free frames
+ * Effect: none
+ */
+uint32_t frames_available(void) {
+	return free_frames;
+}
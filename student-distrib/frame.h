@@ -0,0 +1,28 @@
+/* frame.h
+ */
+
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include "types.h"
+#include "multiboot.h"
+
+#define FRAME_SIZE 4096
+// Everything below 8MB belongs to the kernel, frames past 128MB would collide with user virtual memory
+#define FRAME_POOL_START 0x800000
+#define FRAME_POOL_END 0x8000000
+#define FRAME_COUNT ((FRAME_POOL_END - FRAME_POOL_START) / FRAME_SIZE)
+// Multiboot memory map type of usable ram
+#define MMAP_AVAILABLE 1
+
+void frame_init(multiboot_info_t* mbi);
+uint32_t frame_alloc(void);
+uint32_t frames_alloc(uint32_t count);
+void frame_free(uint32_t addr);
+void frames_free(uint32_t addr, uint32_t count);
+void frame_ref(uint32_t addr);
+uint32_t frame_refcount(uint32_t addr);
+uint32_t frame_pool_top(void);
+uint32_t frames_available(void);
+
+#endif /* _FRAME_H */
@@ -8,34 +8,138 @@
 
 #include "fs_module.h"
 #include "system_call.h"
+#include "ramdisk.h"
+#include "bcache.h"
+#include "exe_cache.h"
 
 //global boot block; only one
 boot_block_t* boot_block = NULL;
 
+//name index built at fs_init; each slot holds a dentry index or DENTRY_HASH_EMPTY
+uint8_t dentry_hash[DENTRY_HASH_SIZE];
+
+//one bit per inode and per data block, set when a file owns it
+uint8_t inode_bitmap[RAMDISK_BLOCKS / 8];
+uint8_t block_bitmap[RAMDISK_BLOCKS / 8];
+
+//disk block number of a data block, data blocks start after the boot block and the inodes
+#define DATA_BLOCK(data) (1 + boot_block->inode + (data))
+//location of inode is inode from boot_block location; + 1 is to account for the boot block itself
+#define INODE(inode) ((inode_t*) boot_block + ((inode) + 1))
+#define BITMAP_TEST(map, i) ((map)[(i) / 8] & (1 << ((i) % 8)))
+#define BITMAP_SET(map, i) ((map)[(i) / 8] |= (1 << ((i) % 8)))
+#define BITMAP_CLEAR(map, i) ((map)[(i) / 8] &= ~(1 << ((i) % 8)))
+
 fops_table_t dir_fops = {
 	.open = dir_open,
 	.close = dir_close,
 	.read = dir_read,
-	.write = dir_write
+	.write = dir_write,
+	.poll = dir_poll
 };
 
 fops_table_t file_fops = {
 	.open = file_open,
 	.close = file_close,
 	.read = file_read,
-	.write = file_write
+	.write = file_write,
+	.readv = file_readv,
+	.poll = file_poll
 };
 
 /*
    fs_init
-   		DESCRIPTION: initialize file system from module start location
-   		INPUTS: N/A
+   		DESCRIPTION: initialize file system from module start location, runs before paging
+   		INPUTS: module_start - file system image from the boot module
 		OUTPUT: N/A
-		SIDE EFFECTS: boot block pointer set to module start
+		SIDE EFFECTS: image copied onto the ram disk with the rest of the disk as free data
+					  blocks, boot block pointer set to the disk, name index and bitmaps built
  */
 void fs_init(uint32_t module_start){
 
-	boot_block = (boot_block_t*) module_start;
+	boot_block_t* image = (boot_block_t*) module_start;
+
+	//copy the image onto the ram disk, the blocks behind it become free data blocks
+	ramdisk_init(module_start, 1 + image->inode + image->data_blocks);
+	boot_block = (boot_block_t*) ramdisk_block_addr(0);
+	boot_block->data_blocks = ramdisk_blocks() - 1 - boot_block->inode;
+	bcache_init();
+
+	int i = 0;
+	for(i = 0; i < DENTRY_HASH_SIZE; i++)
+		dentry_hash[i] = DENTRY_HASH_EMPTY;
+
+	memset(inode_bitmap, 0, sizeof(inode_bitmap));
+	memset(block_bitmap, 0, sizeof(block_bitmap));
+
+	//insert every directory entry, mark what each file owns
+	for(i = 0; i < boot_block->dir_entries && i < MAX_FILECOUNT; i++){
+
+		dentry_t* f = &(boot_block->entries[i]);
+		dentry_hash_insert(i);
+
+		if(f->type != 2 || f->inode >= boot_block->inode || f->inode >= RAMDISK_BLOCKS)
+			continue;
+		BITMAP_SET(inode_bitmap, f->inode);
+
+		inode_t* inode_temp = INODE(f->inode);
+		uint32_t j;
+		for(j = 0; j * FS_BLOCK_SIZE < inode_temp->length && j < MAX_DATA_BLOCK; j++){
+			if(inode_temp->data_block[j] < RAMDISK_BLOCKS)
+				BITMAP_SET(block_bitmap, inode_temp->data_block[j]);
+		}
+	}
+}
+
+/*
+   dentry_hash_insert
+   		DESCRIPTION: adds a directory entry to the name index, linear probing on collisions
+   		INPUTS: index - index of the entry in the boot block
+		OUTPUT: N/A
+		SIDE EFFECTS: one dentry_hash slot filled
+ */
+void dentry_hash_insert(uint32_t index){
+
+	dentry_t* f = &(boot_block->entries[index]);
+	uint32_t slot = dentry_name_hash(f->name, dentry_name_length(f->name));
+
+	while(dentry_hash[slot] != DENTRY_HASH_EMPTY)
+		slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+	dentry_hash[slot] = index;
+}
+
+/*
+   dentry_name_length
+   		DESCRIPTION: length of a dentry name, which is only NUL terminated if shorter than 32 chars
+   		INPUTS: name - name field of a dentry
+		OUTPUT: length of the name, at most MAX_FILENAME
+		SIDE EFFECTS: none
+ */
+uint32_t dentry_name_length(const char* name){
+
+	uint32_t len = 0;
+	while(len < MAX_FILENAME && name[len] != '\0')
+		len++;
+	return len;
+}
+
+/*
+   dentry_name_hash
+   		DESCRIPTION: FNV-1a hash of a file name, used to index dentry_hash
+   		INPUTS: name - file name
+				len - number of chars of the name to hash
+		OUTPUT: slot of the name in dentry_hash
+		SIDE EFFECTS: none
+ */
+uint32_t dentry_name_hash(const char* name, uint32_t len){
+
+	uint32_t hash = 2166136261U;	//FNV offset basis
+	uint32_t i = 0;
+	for(i = 0; i < len; i++){
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619U;			//FNV prime
+	}
+	return hash & (DENTRY_HASH_SIZE - 1);
 }
 
 /*
@@ -48,31 +152,31 @@ void fs_init(uint32_t module_start){
  */
 int32_t read_dentry_by_name(const char* fname, dentry_t* dentry){
 
-	int fname_length = strlen(fname);
-	//printf("file name length: %d", fname_length);
-	if(fname_length > MAX_FILENAME)	//check that file name does not exceed limit
+	if(fname == NULL || dentry == NULL)		//Make sure pointers are valid
 		return -1;
 
-	if(dentry == NULL)						//Make sure pointer is valid
+	//names are at most 32 chars, so never scan further than one char past that
+	uint32_t fname_length = 0;
+	while(fname_length <= MAX_FILENAME && fname[fname_length] != '\0')
+		fname_length++;
+	//printf("file name length: %d", fname_length);
+	if(fname_length > MAX_FILENAME || fname_length == 0)	//check that file name does not exceed limit
 		return -1;
 
-	int i = 0;
-	for(i = 0; i < MAX_FILECOUNT; i++){		//loop through all dir. entries and find matching file
-
-		//load file entry at [i]
-		dentry_t* f = &(boot_block->entries[i]);
+	//probe the name index from the name's home slot until an empty slot
+	uint32_t slot = dentry_name_hash(fname, fname_length);
+	while(dentry_hash[slot] != DENTRY_HASH_EMPTY){
 
-		//if all char in string match, file is found
-		//fname_length + 1 to account for terminating 0x0
-		if(fname_length < MAX_FILENAME)
-			fname_length++;
+		//load file entry the slot points to
+		dentry_t* f = &(boot_block->entries[dentry_hash[slot]]);
 
-		//compare strings and copy file info if match
-		if(strncmp(fname, f->name, fname_length) == 0){
+		//compare strings and copy file info if match, 32 char names have no terminating 0x0
+		if(dentry_name_length(f->name) == fname_length && strncmp(fname, f->name, fname_length) == 0){
 
 			*dentry = *f;
 			return 0;
 		}
+		slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
 	}
 
 	//file not found
@@ -103,20 +207,19 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
 
 /*
    read_data
-   		DESCRIPTION: Reads file data onto buffer
+   		DESCRIPTION: Reads file data onto buffer through the block cache
    		INPUTS: inode - index node of file
 				offset - starting position of read
 				buf - buffer to be filled
 				length - length of data to be read
-		OUTPUT: 0 on success, -1 on failure
+		OUTPUT: number of bytes read, 0 at end of file, -1 on failure
 		SIDE EFFECTS: file data is copied to buffer
  */
 int32_t read_data(uint32_t inode, uint32_t offset, char* buf, uint32_t length){
 
-	uint32_t first_block = offset / 4096;			//position of first data block is offset/size of each block which is 4KB(4096B)
-	uint32_t last_block = (offset + length) / 4096;	//position of last data block is (offset + length) / size of each block
-	uint32_t data = 0;
 	uint32_t bytes_copied = 0;
+	uint32_t block, start, len;
+	bcache_buf_t* cached;
 
 	if(buf == NULL)					//if buffer pointer is invalid, failure
 		return -1;
@@ -124,86 +227,325 @@ int32_t read_data(uint32_t inode, uint32_t offset, char* buf, uint32_t length){
 	if(inode >= boot_block->inode)	//if inode index exceeds max, failure
 		return -1;
 
-	//location of inode is inode from boot_block location; + 1 is to account for the boot block itself
-	inode_t* inode_temp = (inode_t*) boot_block + (inode + 1);
+	inode_t* inode_temp = INODE(inode);
+
+	//if offset reaches beyond end of file, return 0
+	if(offset >= inode_temp->length)
+		return 0;
 
 	//if length puts it over the end of file, reduce back to file size
-	if(offset + length > inode_temp->length)
+	if(length > inode_temp->length - offset)
 		length = inode_temp->length - offset;
 
-	//if offset reaches beyond end of file, return 0
+	while(bytes_copied < length){
+
+		//copy from offset to the end of its block, or less in the last block
+		block = (offset + bytes_copied) / FS_BLOCK_SIZE;
+		start = (offset + bytes_copied) % FS_BLOCK_SIZE;
+		len = FS_BLOCK_SIZE - start;
+		if(len > length - bytes_copied)
+			len = length - bytes_copied;
+
+		if(inode_temp->data_block[block] >= boot_block->data_blocks)
+			return -1;
+		//the buffer stays pinned if copying into buf page faults and reads another file
+		cached = bcache_get(DATA_BLOCK(inode_temp->data_block[block]), 1);
+		if(cached == NULL)
+			return -1;
+		memcpy(buf + bytes_copied, cached->data + start, len);
+		bcache_put(cached);
+
+		//add to total bytes copied
+		bytes_copied += len;
+	}
+	return bytes_copied;
+}
+
+/*
+   read_data_v
+   		DESCRIPTION: Scatter version of read_data, fills several buffers in order
+					 with one walk over the file's blocks
+   		INPUTS: inode - index node of file
+				offset - starting position of read
+				iov - buffers to be filled, already checked by the caller
+				iovcnt - number of buffers
+		OUTPUT: number of bytes read, 0 at end of file, -1 on failure
+		SIDE EFFECTS: file data is copied to the buffers
+ */
+int32_t read_data_v(uint32_t inode, uint32_t offset, iovec_t* iov, int32_t iovcnt){
+
+	uint32_t bytes_copied = 0, length = 0;
+	uint32_t block, start, len, seg_done = 0;
+	int32_t seg = 0, i;
+	bcache_buf_t* cached;
+
+	if(inode >= boot_block->inode)	//if inode index exceeds max, failure
+		return -1;
+
+	inode_t* inode_temp = INODE(inode);
+
 	if(offset >= inode_temp->length)
 		return 0;
 
-	int i = 0;
-	for(i = first_block; i <= last_block; i++){		//loop through all blocks within inode
+	for(i = 0; i < iovcnt; i++)
+		length += iov[i].len;
+	if(length > inode_temp->length - offset)
+		length = inode_temp->length - offset;
 
-		//Get position of data block, then compute position of given data block
-		data = inode_temp->data_block[i];
-		data_block_t* data_location = (data_block_t*) boot_block + (boot_block->inode + data + 1);
+	while(bytes_copied < length){
+
+		block = (offset + bytes_copied) / FS_BLOCK_SIZE;
+		start = (offset + bytes_copied) % FS_BLOCK_SIZE;
+		if(inode_temp->data_block[block] >= boot_block->data_blocks)
+			return -1;
+		cached = bcache_get(DATA_BLOCK(inode_temp->data_block[block]), 1);
+		if(cached == NULL)
+			return -1;
+
+		//hand out the rest of this block across as many buffers as it covers
+		while(start < FS_BLOCK_SIZE && bytes_copied < length){
+			if(seg_done == iov[seg].len){
+				seg++;
+				seg_done = 0;
+				continue;
+			}
+			len = FS_BLOCK_SIZE - start;
+			if(len > iov[seg].len - seg_done)
+				len = iov[seg].len - seg_done;
+			if(len > length - bytes_copied)
+				len = length - bytes_copied;
+			memcpy((char*)iov[seg].base + seg_done, cached->data + start, len);
+			start += len;
+			seg_done += len;
+			bytes_copied += len;
+		}
+		bcache_put(cached);
+	}
+	return bytes_copied;
+}
 
-		//default "offsets" if whole block is to be copied
-		int start_offset = 0;
-		int end_offset = 4096;
+/*
+   inode_length
+   		DESCRIPTION: length of a file in bytes
+   		INPUTS: inode - index node of file
+		OUTPUT: length of the file, 0 for an invalid inode
+		SIDE EFFECTS: none
+ */
+uint32_t inode_length(uint32_t inode){
 
-		/* for reference
+	if(inode >= boot_block->inode)	//if inode index exceeds max, failure
+		return 0;
 
-		   offset  length
-			 |----------->|
-		|	||  |	|	| | |	|
-			 |			  |
-		start_offset  end_offset
+	//location of inode is inode from boot_block location; + 1 is to account for the boot block itself
+	inode_t* inode_temp = (inode_t*) boot_block + (inode + 1);
+	return inode_temp->length;
+}
 
-		each block size 4096B
-		*/
+/*
+   data_block_addr
+   		DESCRIPTION: finds where one of a file's data blocks sits on the ram disk
+   		INPUTS: inode - index node of file
+				block - which 4KB block of the file
+		OUTPUT: address of the data block, 0 if block is past the end of the file
+		SIDE EFFECTS: none, the block is stale while it is dirty in the cache, bcache_sync first
+ */
+uint32_t data_block_addr(uint32_t inode, uint32_t block){
 
-		//if first block, you copy from block location + start_offset to end of block
-		if(i == first_block){
-			start_offset = (offset%4096);
-		}
-		//if last block, you copy from start of block to end_offset
-		if(i == last_block){
-			//if invalid last block, quit out before copying
-			if(last_block*4096 > inode_temp->length)
-				break;
-			end_offset = (offset + length)%4096;
+	if(block * 4096 >= inode_length(inode))
+		return 0;
+
+	inode_t* inode_temp = (inode_t*) boot_block + (inode + 1);
+	return ramdisk_block_addr(DATA_BLOCK(inode_temp->data_block[block]));
+}
+
+/*
+   block_alloc
+   		DESCRIPTION: takes a free data block and zeroes it
+   		INPUTS: N/A
+		OUTPUT: data block number, -1 if the disk is full
+		SIDE EFFECTS: block marked used, zeroed copy left dirty in the cache
+ */
+static int32_t block_alloc(void){
+
+	uint32_t i;
+	bcache_buf_t* cached;
+
+	for(i = 0; i < boot_block->data_blocks && i < RAMDISK_BLOCKS; i++){
+		if(BITMAP_TEST(block_bitmap, i))
+			continue;
+
+		//the whole block is overwritten, don't read it in
+		cached = bcache_get(DATA_BLOCK(i), 0);
+		if(cached == NULL)
+			return -1;
+		memset(cached->data, 0, FS_BLOCK_SIZE);
+		bcache_mark_dirty(cached);
+		bcache_put(cached);
+
+		BITMAP_SET(block_bitmap, i);
+		return i;
+	}
+	return -1;
+}
+
+/*
+   inode_resize
+   		DESCRIPTION: grows or shrinks a file, must be called with interrupts off
+   		INPUTS: inode_temp - inode of the file
+				length - new length in bytes
+		OUTPUT: 0 on success, -1 if the disk is full or the file would be too long
+		SIDE EFFECTS: new bytes read as zero, blocks past the end go back to the free bitmap
+ */
+static int32_t inode_resize(inode_t* inode_temp, uint32_t length){
+
+	uint32_t used = (inode_temp->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+	uint32_t needed = (length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+	uint32_t i;
+	int32_t block;
+	bcache_buf_t* cached;
+
+	if(needed > MAX_DATA_BLOCK)
+		return -1;
+
+	//zero the tail of the last block, so growing later never shows old data
+	if(length < inode_temp->length && (length % FS_BLOCK_SIZE) != 0){
+		cached = bcache_get(DATA_BLOCK(inode_temp->data_block[length / FS_BLOCK_SIZE]), 1);
+		if(cached == NULL)
+			return -1;
+		memset(cached->data + (length % FS_BLOCK_SIZE), 0, FS_BLOCK_SIZE - (length % FS_BLOCK_SIZE));
+		bcache_mark_dirty(cached);
+		bcache_put(cached);
+	}
+
+	for(i = needed; i < used; i++)
+		BITMAP_CLEAR(block_bitmap, inode_temp->data_block[i]);
+
+	for(i = used; i < needed; i++){
+		block = block_alloc();
+		if(block == -1){
+			//keep what was allocated, the file just doesn't reach the new length
+			inode_temp->length = i * FS_BLOCK_SIZE;
+			return -1;
 		}
+		inode_temp->data_block[i] = block;
+	}
 
-		//length of data to be copied is from start_offset to end_offset.
-		//This way, all edge cases are handled, including when start offset and end offset are in the same block
+	inode_temp->length = length;
+	return 0;
+}
 
-		// int len = end_offset - start_offset;
-		// memcpy(buf + bytes_copied, data_location + start_offset, len);
+/*
+   fs_truncate
+   		DESCRIPTION: sets the length of a file
+   		INPUTS: inode - index node of file
+				length - new length in bytes
+		OUTPUT: 0 on success, -1 on failure or if a task has the file mapped and it would shrink
+		SIDE EFFECTS: file grows with zeros or loses its tail
+ */
+int32_t fs_truncate(uint32_t inode, uint32_t length){
 
-		int len = end_offset - start_offset;
-		uint8_t * addr = (uint8_t*)data_location;
-		addr = (uint8_t*) data_location + start_offset;
-		memcpy(buf + bytes_copied, (uint8_t*)addr, len);
+	uint32_t flags;
+	int32_t result;
 
-		//add to total bytes copied
-		bytes_copied += len;
+	if(inode >= boot_block->inode)
+		return -1;
+
+	cli_and_save(flags);
+	//a mapping reads the freed blocks straight off the disk, whatever file gets them next
+	if(length < INODE(inode)->length && file_mapped(inode)){
+		restore_flags(flags);
+		return -1;
 	}
-	return bytes_copied;
+	result = inode_resize(INODE(inode), length);
+	restore_flags(flags);
+	exe_cache_invalidate(inode);
+	return result;
+}
+
+/*
+   fs_create
+   		DESCRIPTION: finds a file by name, making an empty regular file if there is none
+   		INPUTS: fname - name of file
+				dentry - pointer to dentry object
+		OUTPUT: 0 on success, -1 if the name is invalid or the directory or inodes are full
+		SIDE EFFECTS: dentry object populated with the file, new entries go at the end of the directory
+ */
+int32_t fs_create(const char* fname, dentry_t* dentry){
+
+	uint32_t i, flags, len;
+
+	if(fname == NULL || dentry == NULL)
+		return -1;
+
+	cli_and_save(flags);
+	if(read_dentry_by_name(fname, dentry) == 0){
+		restore_flags(flags);
+		return 0;
+	}
+
+	len = strlen(fname);
+	if(len == 0 || len > MAX_FILENAME || boot_block->dir_entries >= MAX_FILECOUNT){
+		restore_flags(flags);
+		return -1;
+	}
+
+	//any inode no file points at is free
+	for(i = 0; i < boot_block->inode && i < RAMDISK_BLOCKS; i++){
+		if(!BITMAP_TEST(inode_bitmap, i))
+			break;
+	}
+	if(i == boot_block->inode || i == RAMDISK_BLOCKS){
+		restore_flags(flags);
+		return -1;
+	}
+	BITMAP_SET(inode_bitmap, i);
+	INODE(i)->length = 0;
+
+	dentry_t* f = &(boot_block->entries[boot_block->dir_entries]);
+	memset(f, 0, sizeof(dentry_t));
+	memcpy(f->name, fname, len);
+	f->type = 2;
+	f->inode = i;
+	dentry_hash_insert(boot_block->dir_entries);
+	boot_block->dir_entries++;
+
+	*dentry = *f;
+	restore_flags(flags);
+	exe_cache_invalidate(i);
+	return 0;
+}
+
+/*
+   fs_free_blocks
+   		DESCRIPTION: counts the data blocks no file owns
+   		INPUTS: N/A
+		OUTPUT: number of free data blocks
+		SIDE EFFECTS: none
+ */
+uint32_t fs_free_blocks(void){
+
+	uint32_t i, count = 0;
+
+	for(i = 0; i < boot_block->data_blocks && i < RAMDISK_BLOCKS; i++){
+		if(!BITMAP_TEST(block_bitmap, i))
+			count++;
+	}
+	return count;
 }
 
 /*
    file_open
    		DESCRIPTION: open file from file name
-   		INPUTS: inode - index pointer
+   		INPUTS: inode - index pointer, already filled in by syscall_open from its dentry lookup
 				filename - name of file
 		OUTPUT: 0 on success, -1 on failure
-		SIDE EFFECTS: file inode read
+		SIDE EFFECTS: none
  */
 int32_t file_open(int32_t* inode, char* filename){
 
-	dentry_t f;
-
-	//Error out if can't read file
-	if(read_dentry_by_name(filename, &f) == -1)
+	//Error out if the inode syscall_open resolved is invalid
+	if(*inode < 0 || *inode >= boot_block->inode)
 		return -1;
-
-	//copy index node
-	*inode = f.inode;
 	return 0;
 }
 
@@ -222,17 +564,73 @@ int32_t file_close(int32_t* inode){
 
 /*
    file_write
-   		DESCRIPTION: unused function for MP3
+   		DESCRIPTION: write to a file at the fd's position through the block cache
    		INPUTS: inode - index pointer
-				offset - starting point
+				offset - starting point, moved past the written data
 				buf - data to be written
 				len - length
-		OUTPUT: 0 on success, -1 on failure
-		SIDE EFFECTS:
+		OUTPUT: number of bytes written, -1 on failure
+		SIDE EFFECTS: file grows if the write goes past its end, a gap before the
+					  write reads as zeros, cached executable image dropped
  */
 int32_t file_write(int32_t* inode, uint32_t* offset, char* buf, uint32_t len){
 
-	return -1;
+	uint32_t written = 0;
+	uint32_t block, start, chunk, flags;
+	bcache_buf_t* cached;
+
+	if(buf == NULL || *inode < 0 || *inode >= boot_block->inode)
+		return -1;
+	inode_t* inode_temp = INODE(*inode);
+
+	//files end after the blocks one inode can list
+	if(*offset >= MAX_DATA_BLOCK * FS_BLOCK_SIZE)
+		return -1;
+	if(len > MAX_DATA_BLOCK * FS_BLOCK_SIZE - *offset)
+		len = MAX_DATA_BLOCK * FS_BLOCK_SIZE - *offset;
+
+	//writers can't interleave their block allocations
+	cli_and_save(flags);
+	if(*offset + len > inode_temp->length && inode_resize(inode_temp, *offset + len) == -1){
+		//disk full, write what fits
+		if(inode_temp->length <= *offset){
+			restore_flags(flags);
+			return -1;
+		}
+		len = inode_temp->length - *offset;
+	}
+	restore_flags(flags);
+
+	while(written < len){
+		block = (*offset + written) / FS_BLOCK_SIZE;
+		start = (*offset + written) % FS_BLOCK_SIZE;
+		chunk = FS_BLOCK_SIZE - start;
+		if(chunk > len - written)
+			chunk = len - written;
+
+		//the file may have been cut short meanwhile, only read the block in if part of it is kept
+		cli_and_save(flags);
+		if(*offset + written >= inode_temp->length){
+			restore_flags(flags);
+			break;
+		}
+		if(chunk > inode_temp->length - (*offset + written))
+			chunk = inode_temp->length - (*offset + written);
+		cached = bcache_get(DATA_BLOCK(inode_temp->data_block[block]), chunk != FS_BLOCK_SIZE);
+		restore_flags(flags);
+		if(cached == NULL)
+			break;
+
+		//the pinned buffer stays put while the user buffer faults pages in
+		memcpy(cached->data + start, buf + written, chunk);
+		bcache_mark_dirty(cached);
+		bcache_put(cached);
+		written += chunk;
+	}
+
+	exe_cache_invalidate(*inode);
+	*offset += written;
+	return written;
 }
 
 /*
@@ -254,24 +652,46 @@ int32_t file_read(int32_t* inode, uint32_t* offset, char* buf, uint32_t len){
 	return result;
 }
 
+/*
+   file_readv
+   		DESCRIPTION: scatter read from the fd's position into several buffers
+   		INPUTS: inode - index pointer
+				offset - starting point, moved past the data read
+				iov - buffers to fill
+				iovcnt - number of buffers
+		OUTPUT: number of bytes read, -1 on failure
+		SIDE EFFECTS: data read to the buffers
+ */
+int32_t file_readv(int32_t* inode, uint32_t* offset, iovec_t* iov, int32_t iovcnt){
+
+	int32_t result = read_data_v(*inode, *offset, iov, iovcnt);
+	if(result > 0)
+		*offset += result;
+	return result;
+}
+
+/*
+   file_poll
+   		DESCRIPTION: what a file read or write would do without blocking
+   		INPUTS: inode, offset - unused
+		OUTPUT: POLLIN | POLLOUT, file reads and writes never sleep
+		SIDE EFFECTS: none
+ */
+int32_t file_poll(int32_t* inode, uint32_t* offset){
+	return POLLIN | POLLOUT;
+}
+
 /*
    dir_open
    		DESCRIPTION: open directory from file name
-   		INPUTS: inode - index pointer
+   		INPUTS: inode - index pointer, already filled in by syscall_open from its dentry lookup
 				filename - name of file to open
 		OUTPUT: 0 on success, -1 on failure
-		SIDE EFFECTS: index copied
+		SIDE EFFECTS: none
  */
 int32_t dir_open(int32_t* inode, char* filename){
 
-	dentry_t f;
-
-	//Error out if can't read file
-	if(read_dentry_by_name(filename, &f) == -1)
-		return -1;
-
-	//copy index
-	*inode = f.inode;
+	//the directory's dentry was resolved by syscall_open, nothing left to look up
 	return 0;
 }
 
@@ -321,6 +741,17 @@ int32_t dir_read(int32_t* inode, uint32_t* offset, char* buf, uint32_t len){
     return result;
 }
 
+/*
+   dir_poll
+   		DESCRIPTION: what a directory read or write would do without blocking
+   		INPUTS: inode, offset - unused
+		OUTPUT: POLLIN, directory reads never sleep and it can't be written
+		SIDE EFFECTS: none
+ */
+int32_t dir_poll(int32_t* inode, uint32_t* offset){
+	return POLLIN;
+}
+
 /*
    directory_read
    		DESCRIPTION: reads file directory
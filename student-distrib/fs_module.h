@@ -13,6 +13,8 @@
 #define MAX_FILENAME 32
 #define MAX_FILECOUNT 63
 #define MAX_DATA_BLOCK 1023		//Max number of data blocks is (4096/4 - 1) Because first block is reserved and each block is 4B
+#define DENTRY_HASH_SIZE 128		//open addressed name index, power of 2 and at least twice MAX_FILECOUNT
+#define DENTRY_HASH_EMPTY 0xFF		//marks an unused slot in the name index
 
 	
 typedef struct {	//dir. entry struct
@@ -42,24 +44,44 @@ typedef struct {	//data block struct
 //file system initialization function
 void fs_init(uint32_t module_start);
 
+//name index helpers, used to build and probe the dentry hash
+uint32_t dentry_name_length(const char* name);
+uint32_t dentry_name_hash(const char* name, uint32_t len);
+
+//add a directory entry to the name index
+void dentry_hash_insert(uint32_t index);
+
 //read dir entry given a file name
 int32_t read_dentry_by_name(const char* fname, dentry_t* dentry);
 
 //read dir entry given an index node
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 
+//length and in-module address of a file's data blocks, for mapping files without copying
+uint32_t inode_length(uint32_t inode);
+uint32_t data_block_addr(uint32_t inode, uint32_t block);
+
+//create a file, change its length, count free space
+int32_t fs_create(const char* fname, dentry_t* dentry);
+int32_t fs_truncate(uint32_t inode, uint32_t length);
+uint32_t fs_free_blocks(void);
+
 //read data from file given inode, offset, and length
 int32_t read_data(uint32_t inode, uint32_t offset, char* buf, uint32_t length);
+int32_t read_data_v(uint32_t inode, uint32_t offset, iovec_t* iov, int32_t iovcnt);
 
 //open/close/write/read functions for files and directories
 int32_t file_open(int32_t* inode, char* filename);
 int32_t file_close(int32_t* inode);
 int32_t file_write(int32_t* inode, uint32_t* offset, char* buf, uint32_t len);
 int32_t file_read(int32_t* inode, uint32_t* offset, char* buf, uint32_t len);
+int32_t file_readv(int32_t* inode, uint32_t* offset, iovec_t* iov, int32_t iovcnt);
+int32_t file_poll(int32_t* inode, uint32_t* offset);
 int32_t dir_open(int32_t* inode, char* filename);
 int32_t dir_close(int32_t* inode);
 int32_t dir_write(int32_t* inode, uint32_t* offset, char* buf, uint32_t len);
 int32_t dir_read(int32_t* inode, uint32_t* offset, char* buf, uint32_t len);
+int32_t dir_poll(int32_t* inode, uint32_t* offset);
 int32_t directory_read(uint32_t offset, char* buf, uint32_t len);
 
 //fops table for file and directory
@@ -8,6 +8,7 @@
 	extern void pit_handler_asm();
     extern void keyboard_handler_asm();
     extern void rtc_handler_asm();
+    extern void page_fault_handler_asm();
 #endif
 
 #endif
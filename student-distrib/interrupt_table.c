@@ -17,6 +17,15 @@
 #define VECTOR_RTC			0x28
 #define VECTOR_SYSCALL		0x80
 
+// Model specific registers sysenter loads cs, esp and eip from
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
+
+#define EFLAGS_IF			0x200	//interrupt flag of the faulting context
+#define PF_PRESENT			0x01	//page fault error code bit, set when the page was present
+#define PF_WRITE			0x02	//page fault error code bit, set when the access was a write
+
 //Invoke handlers for each exception; for CP1 simply display exception and hold while loop
 HANDLE_EXCEPTION(exception_divide_error, "DIVIDE ERROR");
 HANDLE_EXCEPTION(debug_intel_only, "DEBUG INTEL ONLY");	//debug only
@@ -38,6 +47,33 @@ HANDLE_EXCEPTION(exception_alignment_check, "ALIGNMENT CHECK");
 HANDLE_EXCEPTION(exception_machine_check, "MACHINE CHECK");
 HANDLE_EXCEPTION(exception_simd_floating_point, "SIMD FLOATING POINT EXCEPTION");
 
+/*
+ * page_fault_handler
+ * 		DESCRIPTION: loads program pages on first touch and copies copy on write pages on
+ *			the first write, anything else is a real page fault
+ * 		INPUTS: error_code - error code pushed by the processor
+ *				addr - cr2, read before anything could switch tasks and fault again
+ *				eflags - eflags of the faulting code
+		OUTPUT: N/A
+		SIDE EFFECTS: maps a page of the running task, or squashes the task
+ */
+void page_fault_handler(uint32_t error_code, uint32_t addr, uint32_t eflags){
+
+	//entered through an interrupt gate, loading a page can take interrupts if the faulting code could
+	if(eflags & EFLAGS_IF)
+		sti();
+
+	//not present pages of the program page are loaded on demand
+	if(!(error_code & PF_PRESENT) && demand_page(addr) == 0)
+		return;
+
+	//pages shared by fork are read only until someone writes them
+	if((error_code & PF_PRESENT) && (error_code & PF_WRITE) && cow_page(addr) == 0)
+		return;
+
+	exception_page_fault();
+}
+
 /*
  * init_idt
  * 		DESCRIPTION: initializes IDT and sets IDT entries for first 18 exceptions
@@ -82,7 +118,8 @@ void init_idt(){
     SET_IDT_ENTRY(idt[0x0B], exception_segment_not_present);
     SET_IDT_ENTRY(idt[0x0C], exception_stack_segment_fault);
     SET_IDT_ENTRY(idt[0x0D], exception_general_protection);
-    SET_IDT_ENTRY(idt[0x0E], exception_page_fault);
+    SET_IDT_ENTRY(idt[0x0E], page_fault_handler_asm);
+	idt[0x0E].reserved3 = 0;	//interrupt gate, no task switch before cr2 is read
     // idt[0x0F] for INTEL use only
     SET_IDT_ENTRY(idt[0x10], exception_x87_fpu_error);
     SET_IDT_ENTRY(idt[0x11], exception_alignment_check);
@@ -104,3 +141,20 @@ void init_idt(){
 	//set pointer to IDT
 	lidt(idt_desc_ptr);	
 }
+
+/*
+ * sysenter_init
+ * 		DESCRIPTION: programs the sysenter MSRs so user programs can make system calls
+ *			without going through the 0x80 gate. sysenter only loads esp from its MSR,
+ *			so the MSR points at tss.esp0 and the entry stub loads the task's real
+ *			kernel stack from there
+ * 		INPUTS: N/A
+		OUTPUT: N/A
+		SIDE EFFECTS: sysenter enters sysenter_handler_asm on KERNEL_CS/KERNEL_DS,
+			sysexit returns on USER_CS/USER_DS
+ */
+void sysenter_init(){
+	asm volatile("wrmsr" : : "c" (MSR_SYSENTER_CS), "a" (KERNEL_CS), "d" (0));
+	asm volatile("wrmsr" : : "c" (MSR_SYSENTER_ESP), "a" (&tss.esp0), "d" (0));
+	asm volatile("wrmsr" : : "c" (MSR_SYSENTER_EIP), "a" (sysenter_handler_asm), "d" (0));
+}
@@ -12,12 +12,17 @@
 
 	//initialize interrupt table
 	void init_idt();
+
+	//point the sysenter MSRs at the fast system call entry
+	void sysenter_init();
 	
 	//handle exception macro: prints error message and holds while loop
 	//also checks if a task is running, if it is, squash it
+	//the message is flushed by hand since no PIT tick may come to show it
     #define HANDLE_EXCEPTION(exception_name, message) \
         void exception_name(){                        \
             printf(message);                		  \
+            screen_flush();                 		  \
 			if(get_tasks_running()){putc('\n'); set_exception_death(); syscall_halt(0);}\
             while(1) {}                    			  \
         }											  \
@@ -14,6 +14,9 @@
 #include "paging.h"
 #include "fs_module.h"
 #include "system_call.h"
+#include "frame.h"
+#include "interrupt_table.h"
+#include "vdso.h"
 
 #define RUN_TESTS
 
@@ -27,7 +30,8 @@ void entry(unsigned long magic, unsigned long addr) {
 
     multiboot_info_t *mbi;
 
-    /* Clear the screen. */
+    /* Terminal colors and scroll regions, then clear the screen. */
+    terminal_init();
     clear();
 
     /* Am I booted by a Multiboot-compliant boot loader? */
@@ -39,6 +43,10 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Set MBI to the address of the Multiboot information structure. */
     mbi = (multiboot_info_t *) addr;
 
+    /* Hand the usable ram above the kernel to the frame allocator, the file system
+     * takes its ram disk from it */
+    frame_init(mbi);
+
     /* Print out the flags. */
     //printf("flags = 0x%#x\n", (unsigned)mbi->flags);
 
@@ -143,12 +151,16 @@ void entry(unsigned long magic, unsigned long addr) {
         ltr(KERNEL_TSS);
     }
 
+    /* Fast system call entry, needs the TSS for the kernel stack */
+    sysenter_init();
+
     /* Init the PIC */
     i8259_init();
 
     /* Initialize devices, memory, filesystem, enable device interrupts on the
      * PIC, any other initialization stuff... */
     paging_init();
+    vdso_init();
 	// DO NOT INIT KEYBOARD/RTC HERE FOR CHECKPOINT 1, THEY INIT IN THEIR TESTS
 	keyboard_init();
 	rtc_init();
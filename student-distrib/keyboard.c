@@ -6,19 +6,23 @@
 #include "lib.h"
 #include "system_call.h"
 #include "scheduler.h"
+#include "vdso.h"
 
 fops_table_t stdin_fops = {
 	.open = terminal_open,
-	.close = NULL,
+	.close = terminal_close,
 	.read = terminal_read,
 	.write = NULL,
+	.ioctl = terminal_ioctl,
+	.poll = terminal_poll,
 };
 
 fops_table_t stdout_fops = {
 	.open = terminal_open,
-	.close = NULL,
+	.close = terminal_close,
 	.read = NULL,
 	.write = terminal_write,
+	.poll = terminal_write_poll,
 };
 
 // Last letter is 0x3A = 59, so need size 51
@@ -90,12 +94,34 @@ uint8_t scan_codes[61][4] = {
 };
 
 
+/* terminal_init()
+ * Inputs: none
+ * Returns: none
+ * Effects: Default colors and a full screen scroll region on every terminal. Runs
+ *			before anything is printed
+ */
+void terminal_init(void) {
+	int i;
+
+	for (i=0; i<TERMINAL_COUNT; i++)
+		vt100_init(&terminal[i].vt);
+}
+
 /* keyboard_init() (heffley)
  * Inputs: none
  * Returns: none
- * Effects: Enables keyboard irq
+ * Effects: Enables keyboard irq, sets up the terminal read queues and line disciplines
  */
 void keyboard_init(void) {
+	int i;
+
+	// No task is waiting for input yet
+	for (i=0; i<TERMINAL_COUNT; i++) {
+		wait_queue_init(&terminal[i].read_queue);
+		ldisc_init(&terminal[i].ldisc);
+		scrollback_init(&terminal[i].history);
+	}
+
 	// Enable keyboard irq on PIC
 	enable_irq(KEYBOARD_IRQ_NUM);
 }
@@ -111,12 +137,22 @@ void keyboard_init(void) {
  	uint8_t char_to_print;
  	char_to_print = '\0';
 
-	// check whether the press_code is within bonds
+	// check whether the press_code is within bonds, raw readers still see the other keys
  	if ((press_code <0 ) || (press_code > 0xBD)){
+		if (press_code < KEY_PREFIX)
+			terminal_buf_add(press_code, '\0');
+		send_eoi(KEYBOARD_IRQ_NUM);
+		return;
+	}
+	// shift+page up/down pages through the displayed terminal's history
+	if ((press_code == page_up || press_code == page_down) &&
+		(scan_codes[leftshift][3] == 1 || scan_codes[rightshift][3] == 1)) {
+		screen_scroll(press_code == page_up ? NUM_ROWS - 1 : -(NUM_ROWS - 1));
 		send_eoi(KEYBOARD_IRQ_NUM);
 		return;
 	}
  	if ((press_code >0x3D) && (press_code < 0x81)) {
+		terminal_buf_add(press_code, '\0');
 		send_eoi(KEYBOARD_IRQ_NUM);
 		return;
 	}
@@ -171,7 +207,7 @@ void keyboard_init(void) {
 		 
  	}
  	else if (press_code == 0x0E ){
- 		terminal_backspace(); 
+ 		terminal_buf_add(press_code, KEY_BACKSPACE);
  	}
 	
 	else if ((scan_codes[leftAlt][3] == 1) && (scan_codes[function1_key][3] ==1)){
@@ -187,9 +223,9 @@ void keyboard_init(void) {
 	}
 
 
-	//print the char
- 	else if ( char_to_print != '\0')
- 		terminal_buf_add (char_to_print);
+	//queue the key, releases too
+ 	else
+ 		terminal_buf_add (press_code, char_to_print);
  	// Send EOI to PIC
  	send_eoi(KEYBOARD_IRQ_NUM);
  }
@@ -206,59 +242,21 @@ void keyboard_init(void) {
 	reset_position();
 
  }
- /* terminal_backspace()
-  * Inputs: none
-  * Outputs: none
-  * Effects: creaate backspace effect
-  */
-void terminal_backspace(){
-	 char space = ' ';
-	if (terminal[display_terminal_id].keyboard_buffer_size == 0)
-		return;
-	// int scr_x;
-	// int scr_y;
-	// getScreenPos(scr_x, scr_y);
-	// printf("%d, %d", scr_x, scr_y );
-	// scr_x --;
-	// setScreenPos(scr_x, scr_y);
-	back_space();
-	terminal[display_terminal_id].keyboard_buffer[terminal[display_terminal_id].keyboard_buffer_size] = '\0';
-	terminal[display_terminal_id].keyboard_buffer_size --;
-	printf("%c", space );
-	back_space();
-
-}
-
 /* terminal_open() (xunli3)
  * Inputs: none
  * Outputs: none
- * Effects: initializes stuff
+ * Effects: none, the terminals are set up by terminal_init and keyboard_init and
+ *			opening one again must not drop what was typed ahead
  */
 int terminal_open(int32_t* ignore, char* filename){
-	int i,j;   //looping variable
-
-	display_terminal_id=0;
-	for (j=0; j<TERMINAL_COUNT; j++){
-	terminal[display_terminal_id].allow_terminal_read=0;
-	terminal[display_terminal_id].cursor_pos_x=0;
-	terminal[display_terminal_id].cursor_pos_y=0;
-	terminal[display_terminal_id].keyboard_buffer_size = 0;
-	
-	
-
-	for (i=0; i<KEYBOARD_MAX_BUFFER; i++){
-		terminal[display_terminal_id].keyboard_buffer[i]= '\0';    //initializes keyboard buffer to null string
-	}
-
-	}
-
 	return 0;
 }
 
 /* terminal_close() (xunli3)
  * Inputs: none
  * Outputs: none
- * Effects: Closes the terminal, but this will never be called
+ * Effects: none, the terminal stays open for everyone else. Called when a
+ *			copy dup2 made of stdin or stdout is closed
  */
 int terminal_close(int32_t* fd){
 
@@ -269,150 +267,128 @@ return 0;
 
 /* terminal_read() (xunli3)
  * Inputs: none
- * Outputs: number of bytes read from keyboard buffer
- * Effects: resets keyboard buffer
+ * Outputs: number of bytes read, a whole line at most
+ * Effects: sleeps until the terminal the calling task belongs to has a line typed
  */
 int terminal_read(int32_t* fd, uint32_t* ignore, char* buf, uint32_t nbytes){
-	int i;
-	int numbytes=0;
-
-	//spins until terminal is allowed to read the keyboard buffer after the user presses enter
-	while (!terminal[display_terminal_id].allow_terminal_read);
-
-
-    												/*cli and sti so that no inputs are allowed
-														when user terminal reads from keyboard buffer*/
-	cli();
-	for (i=0; i<nbytes; i++){
-		buf[i]=terminal[display_terminal_id].keyboard_buffer[i];
-		terminal[display_terminal_id].keyboard_buffer[i]='\0';
-		if (buf[i]!='\0'){
-        numbytes++;
-        } else 
-			break;
-	}
+	if (buf == NULL)
+		return -1;
 
-							
-	terminal[display_terminal_id].keyboard_buffer_size=0;
-	terminal[display_terminal_id].allow_terminal_read=0;				//stops terminal_read when user is ready to input next command
+	return ldisc_read(get_active_terminal(), (uint8_t*)buf, nbytes);
+}
 
-	sti();
-	return numbytes;
+/* terminal_ioctl()
+ * Inputs: IOCTL_TERM_MODE and the TERM_ flags to use, or IOCTL_TERM_GET
+ * Outputs: the flags before, -1 for other requests or flags
+ * Effects: switches the calling task's terminal between line input and raw key
+ *			events, blocking or not. It goes back to line input when the task halts
+ */
+int32_t terminal_ioctl(int32_t* fd, int32_t request, int32_t arg){
+	ldisc_t* ld = &terminal[get_active_terminal()].ldisc;
+	int32_t old;
+
+	old = ((ld->mode == LDISC_RAW) ? TERM_RAW : 0) | (ld->nonblock ? TERM_NONBLOCK : 0);
+	if (request == IOCTL_TERM_GET)
+		return old;
+	if (request != IOCTL_TERM_MODE || (arg & ~(TERM_RAW | TERM_NONBLOCK)))
+		return -1;
+
+	ldisc_set_mode(get_active_terminal(), (arg & TERM_RAW) ? LDISC_RAW : LDISC_CANONICAL,
+		(arg & TERM_NONBLOCK) ? 1 : 0, (int32_t) get_tasks_running());
+	return old;
+}
 
+/* terminal_poll()
+ * Inputs: none
+ * Outputs: POLLIN when the calling task's terminal has input a read would return
+ * Effects: none
+ */
+int32_t terminal_poll(int32_t* fd, uint32_t* ignore){
+	return ldisc_poll(get_active_terminal());
+}
+
+/* terminal_write_poll()
+ * Inputs: none
+ * Outputs: POLLOUT, terminal writes never sleep
+ * Effects: none
+ */
+int32_t terminal_write_poll(int32_t* fd, uint32_t* ignore){
+	return POLLOUT;
 }
 
 /* terminal_write() (xunli3)
  * Inputs: none
- * Outputs: number of bytes written
+ * Outputs: number of bytes written, newlines included
  * Effects: print whatever passes through buffer on the screen
  */
 int terminal_write(int32_t* fd, uint32_t* ignore, char* buf, uint32_t nbytes){
-	int i;
-	int numbytes=0;
-
+	if (buf == NULL)
+		return -1;
 
-	for (i=0; i<nbytes; i++){
-		putc(buf[i]);
-
-		if (buf[i]!='\n'){
-        numbytes++;
-        }
-
-	}
-
-	return numbytes;
+	//tasks print on their own terminal whether or not it is shown
+	return terminal_puts(get_active_terminal(), buf, nbytes);
 
 }
 
-/* terminal_buf_add(uint8_t char_to_print)
- * Inputs: char to be printed
+/* terminal_buf_add(uint32_t press_code, uint8_t char_to_print)
+ * Inputs: scancode, char it types or 0
  * Outputs: none
- * Effects: print the char from keyboard in terminal.
+ * Effects: Queues the key on the displayed terminal with the modifiers held now, the
+ *			line discipline echoes it on the next tick
  */
-void terminal_buf_add(uint8_t char_to_print){
-	// see if keyboard_size is over
-	if (terminal[display_terminal_id].keyboard_buffer_size >= KEYBOARD_MAX_BUFFER -2) {
-		return;
-	}
-
-	
-	// signals terminal read
-	if (char_to_print == '\n'){
-	 //while(get_active_terminal() != find_bottom_task(display_terminal_id)){}
-	 putc(char_to_print);
-	 terminal[display_terminal_id].keyboard_buffer[terminal[display_terminal_id].keyboard_buffer_size] = char_to_print;
-	 terminal[display_terminal_id].keyboard_buffer_size++;
-	 terminal[display_terminal_id].allow_terminal_read = 1;
-	}
-
-	else{
-	 putc(char_to_print);
-	 terminal[display_terminal_id].keyboard_buffer[terminal[display_terminal_id].keyboard_buffer_size] = char_to_print;
-	 terminal[display_terminal_id].keyboard_buffer_size++;
-	}
-	// int y = getYpos();
-	//
-	// if (y >= NUM_ROWS -1){
-	// 	scroll_up();
-	// }
-	
-	// if (terminal[display_terminal_id].keyboard_buffer_size == 80){
-	// 	printf("%c", '\n');
-	// }
-
-
+void terminal_buf_add(uint32_t press_code, uint8_t char_to_print){
+	key_event_t ev;
+
+	// typing goes back to the live screen
+	if (char_to_print != '\0')
+		screen_scroll(-SCROLLBACK_LINES);
+
+	ev.scancode = press_code & ~press_release_offset;
+	ev.ch = char_to_print;
+	ev.flags = 0;
+	ev.pad = 0;
+	if (press_code & press_release_offset)
+		ev.flags |= KEY_RELEASED;
+	if (scan_codes[leftshift][3] == 1 || scan_codes[rightshift][3] == 1)
+		ev.flags |= KEY_SHIFT;
+	if (scan_codes[leftCtrl][3] == 1)
+		ev.flags |= KEY_CTRL;
+	if (scan_codes[leftAlt][3] == 1)
+		ev.flags |= KEY_ALT;
+	if (scan_codes[CapsLock][3] == 1)
+		ev.flags |= KEY_CAPS;
+	ldisc_key(&terminal[display_terminal_id].ldisc, ev);
 }
 
 /* switch_display_terminal()
  * Input: terminal id to switch to
  * Return: none
- * Effect: Switches the task that is being displayed on the screen from one terminal to a task from
- *			a different terminal. 
+ * Effect: Switches which terminal is shown on the screen. Only the CRTC start address
+ *			moves, the scheduler keeps running the tasks of every terminal. A terminal
+ *			scrolled back into its history is returned to the live screen.
  */
 void switch_display_terminal(uint32_t tid){
 	if (display_terminal_id==tid || tid <0 || tid>2){
 		return;
 	}
 
-	//remap paging to new process
-	syscall_paging_setup(eightM + (fourM * find_bottom_task(tid)));
-
-	pcb_t* prev_pcb = get_pcb(display_terminal_id);
-	pcb_t* next_pcb = get_pcb(tid);
-
-	// Save current terminal's buffer
-	cpy_screen_pos();
-	memcpy(terminal[display_terminal_id].terminal_buffer, (char*)VIDEO, TERMINAL_SIZE);
-
-	//Prep for task switch
-	tss.ss0 = KERNEL_DS;
-	tss.esp0 = eightM - (eightK * find_bottom_task(tid)) - 4;
+	//the terminal being left goes back to its live screen, its window is repainted on the next flush
+	screen_scroll(-SCROLLBACK_LINES);
 
 	//Update the currently displayed terminal id variable
 	display_terminal_id= tid;
+	vdso_set_terminal(tid);
 
-	//Move the new terminal's buffer into video mem
-	memcpy((char*)VIDEO, terminal[display_terminal_id].terminal_buffer, TERMINAL_SIZE);
-
-	//Update cursor position
-	setScreenPos(terminal[display_terminal_id].cursor_pos_x, terminal[display_terminal_id].cursor_pos_y);
-
-	//Switch the task to a different terminal's
-	switch_running_task(tid);
-	
-	asm volatile (
-	"movl %%esp, %0 \n"
-	"movl %%ebp, %1 \n"
-	:"=r" (prev_pcb->old_esp), "=r" (prev_pcb->old_ebp)
-	:
-	);
-	
-	asm volatile (
-	"movl %0, %%esp \n"
-	"movl %1, %%ebp \n"
-	:"=r" (next_pcb->old_esp), "=r" (next_pcb->old_ebp)
-	:
-	);
+	//every terminal already has its screen in its own VGA window, just show that one
+	screen_show();
 }
 
-
+/* terminal_video_addr()
+ * Input: terminal id
+ * Return: what a vidmap program on that terminal should see, the terminal's VGA
+ *			window whether or not it is shown
+ * Effect: none
+ */
+uint32_t terminal_video_addr(uint32_t tid){
+	return VIDEO + tid * VGA_WINDOW;
+}
@@ -5,7 +5,12 @@
 #define _KEYBOARD_H
 
 #include "types.h"
+#include "lib.h"
 #include "system_call.h"
+#include "wait_queue.h"
+#include "scrollback.h"
+#include "vt100.h"
+#include "ldisc.h"
 
 // See PS/2 Controller page on osdev
 #define KEYBOARD_DATA_PORT 0x60
@@ -20,32 +25,38 @@
 #define function1_key 0x3B
 #define function2_key 0x3C
 #define function3_key 0x3D
+#define page_up 0x49
+#define page_down 0x51
+#define KEY_PREFIX 0xE0			//extended key prefix, codes from here on are not keys
 #define TERMINAL_COUNT 3
-#define TERMINAL_SIZE 4000
+#define TERMINAL_CHUNK 1024		//bytes terminal_puts prints per stretch with interrupts off
 
 // keyboard sits on irq port 1
 #define KEYBOARD_IRQ_NUM   0x1
 
-#define KEYBOARD_MAX_BUFFER  128   //maximum number of characters allowed in buffer
-
 extern void keyboard_init(void);
+void terminal_init(void);
 extern void keyboard_handler(void);
-void terminal_buf_add(uint8_t char_to_print);
+void terminal_buf_add(uint32_t press_code, uint8_t char_to_print);
 void clear_screen();
-void terminal_backspace();
 
 
 //terminal struct
 typedef struct terminal_t{
 
-
-
- uint8_t keyboard_buffer[KEYBOARD_MAX_BUFFER];
  uint32_t cursor_pos_x;                   //current cursor position 0-79
  uint32_t cursor_pos_y;
- int keyboard_buffer_size;              //current buffer size 0-127
- int allow_terminal_read;               //1 to enable keyboard input, 0 to disable
- char terminal_buffer[TERMINAL_SIZE];            //row*col*2
+ ldisc_t ldisc;                           //keys typed on this terminal and the lines made of them
+ //backing buffer, char + attribute per cell, copied into the terminal's VGA window as rows change
+ uint16_t rows[NUM_ROWS][NUM_COLS];
+ uint32_t top_row;                      //row of rows shown at the top, scrolling moves it instead of the text
+ uint32_t dirty;                        //bit y set when screen row y differs from video memory
+ uint32_t scrolled;                     //lines scrolled since the last flush
+ uint32_t vga_top;                      //row of the terminal's VGA window at the top of its screen
+ uint32_t vga_pinned;                   //1 while vidmap hands out the window, it stays at row 0
+ scrollback_t history;                  //rows that scrolled off the top
+ vt100_t vt;                            //escape sequence parser, colors and scroll region
+ wait_queue_t read_queue;               //tasks sleeping in terminal_read until there is input
 
  uint32_t ebp, esp;
 
@@ -59,7 +70,11 @@ int32_t terminal_open(int32_t* ignore, char* filename);
 int32_t terminal_close(int32_t* fd);
 int32_t terminal_read(int32_t* fd, uint32_t* ignore, char* buf, uint32_t nbytes);
 int32_t terminal_write(int32_t* fd, uint32_t* ignore, char* buf, uint32_t nbytes);
+int32_t terminal_ioctl(int32_t* fd, int32_t request, int32_t arg);
+int32_t terminal_poll(int32_t* fd, uint32_t* ignore);
+int32_t terminal_write_poll(int32_t* fd, uint32_t* ignore);
 void switch_display_terminal(uint32_t tid);
+uint32_t terminal_video_addr(uint32_t tid);
 
 
 //void add_to_buffer(uint32_t press_code, uint32_t index);
@@ -0,0 +1,135 @@
+/* latency.c
+ * Interrupt and syscall timing. The asm entry points read the tsc around the
+ * handler and hand the cycle count here, the tables are shown by the "irqstat"
+ * and "sysstat" pseudo files.
+ */
+
+#include "latency.h"
+#include "proc.h"
+#include "lib.h"
+
+latency_t irq_latency[LATENCY_IRQS];
+latency_t syscall_latency[LATENCY_SYSCALLS];
+
+uint32_t context_switches = 0;
+
+static const char* irq_names[LATENCY_IRQS] = {
+	"pit", "keyboard", NULL, NULL, NULL, NULL, NULL, NULL,
+	"rtc", NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+static const char* syscall_names[LATENCY_SYSCALLS] = {
+	"invalid", "halt", "execute", "read", "write", "open", "close", "getargs",
+	"vidmap", "set_handler", "sigreturn", "mmap", "fork", "spawn", "wait", "create",
+	"readv", "writev", "ring_setup", "ring_enter", "ioctl", "poll", "pipe", "dup2"
+};
+
+/* latency_add()
+ * Input: counters to update, cycles the handler took, context switch count at entry
+ * Return: none
+ * Effect: adds the sample, or only counts it if another task ran in between
+ *			since then the cycles include that task's time
+ */
+static void latency_add(latency_t* lat, uint32_t cycles, uint32_t switches) {
+	uint32_t bucket, flags;
+
+	cli_and_save(flags);
+	if(switches != context_switches) {
+		lat->switched++;
+		restore_flags(flags);
+		return;
+	}
+
+	if(lat->count == 0 || cycles < lat->min)
+		lat->min = cycles;
+	if(cycles > lat->max)
+		lat->max = cycles;
+	lat->count++;
+	lat->cycles += cycles & 0x3FF;
+	lat->kcycles += (cycles >> 10) + (lat->cycles >> 10);
+	lat->cycles &= 0x3FF;
+
+	for(bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+		if(cycles < (1 << (LATENCY_BUCKET_BASE + 2 * bucket)))
+			break;
+	}
+	lat->hist[bucket]++;
+	restore_flags(flags);
+}
+
+/* irq_latency_record()
+ * Input: irq number, cycles the handler took, context switch count at entry
+ * Return: none
+ * Effect: called by INTERRUPT_HANDLER after every device interrupt
+ */
+void irq_latency_record(uint32_t irq, uint32_t cycles, uint32_t switches) {
+	if(irq < LATENCY_IRQS)
+		latency_add(&irq_latency[irq], cycles, switches);
+}
+
+/* syscall_latency_record()
+ * Input: syscall number from eax, cycles the call took, context switch count at entry
+ * Return: none
+ * Effect: called by syscall_handler_asm after every syscall, bad numbers count as invalid
+ */
+void syscall_latency_record(uint32_t num, uint32_t cycles, uint32_t switches) {
+	if(num >= LATENCY_SYSCALLS)
+		num = 0;
+	latency_add(&syscall_latency[num], cycles, switches);
+}
+
+/* latency_show()
+ * Input: output buffer and size, table, names of its rows, number of rows
+ * Return: length of the text
+ * Effect: one row per named entry, the average is in cycles
+ */
+static uint32_t latency_show(char* buf, uint32_t size, latency_t* table, const char** names, uint32_t rows) {
+	uint32_t i, j, len = 0;
+	uint32_t values[5 + LATENCY_BUCKETS];
+	latency_t lat;
+	uint32_t flags;
+
+	len = proc_puts(buf, len, size, "name count switched min max avg <256 <1K <4K <16K <64K <256K <1M more\n");
+	for(i = 0; i < rows; i++) {
+		if(names[i] == NULL)
+			continue;
+		cli_and_save(flags);
+		lat = table[i];
+		restore_flags(flags);
+
+		values[0] = lat.count;
+		values[1] = lat.switched;
+		values[2] = lat.min;
+		values[3] = lat.max;
+		values[4] = 0;
+		if(lat.count != 0) {
+			// Keep the division in 32 bits, past 4G cycles the average loses the remainder
+			if(lat.kcycles < (1 << 22))
+				values[4] = ((lat.kcycles << 10) + lat.cycles) / lat.count;
+			else
+				values[4] = (lat.kcycles / lat.count) << 10;
+		}
+		for(j = 0; j < LATENCY_BUCKETS; j++)
+			values[5 + j] = lat.hist[j];
+		len = proc_print_row(buf, len, size, names[i], values, 5 + LATENCY_BUCKETS);
+	}
+	return len;
+}
+
+/* irqstat_show()
+ * Input: output buffer and its size
+ * Return: length of the text
+ * Effect: shows the device interrupt table
+ */
+uint32_t irqstat_show(char* buf, uint32_t size) {
+	return latency_show(buf, size, irq_latency, irq_names, LATENCY_IRQS);
+}
+
+/* sysstat_show()
+ * Input: output buffer and its size
+ * Return: length of the text
+ * Effect: shows the syscall table
+ */
+uint32_t sysstat_show(char* buf, uint32_t size) {
+	return latency_show(buf, size, syscall_latency, syscall_names, LATENCY_SYSCALLS);
+}
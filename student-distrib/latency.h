@@ -0,0 +1,37 @@
+/* latency.h
+ */
+
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include "types.h"
+
+#define LATENCY_IRQS 16
+#define LATENCY_SYSCALLS 24			//syscall numbers 1-23, slot 0 counts invalid calls
+// Histogram bucket b holds samples under 2^(LATENCY_BUCKET_BASE + 2b) cycles, the last one the rest
+#define LATENCY_BUCKETS 8
+#define LATENCY_BUCKET_BASE 8
+
+// rdtsc cycles spent in one interrupt vector or syscall
+typedef struct latency_t {
+	uint32_t count;
+	uint32_t switched;				//samples dropped because the cpu ran another task meanwhile
+	uint32_t min;
+	uint32_t max;
+	uint32_t kcycles;				//total in units of 1024 cycles
+	uint32_t cycles;				//remainder of the total, under 1024
+	uint32_t hist[LATENCY_BUCKETS];
+} latency_t;
+
+void irq_latency_record(uint32_t irq, uint32_t cycles, uint32_t switches);
+void syscall_latency_record(uint32_t num, uint32_t cycles, uint32_t switches);
+uint32_t irqstat_show(char* buf, uint32_t size);
+uint32_t sysstat_show(char* buf, uint32_t size);
+
+extern latency_t irq_latency[LATENCY_IRQS];
+extern latency_t syscall_latency[LATENCY_SYSCALLS];
+
+// Bumped every time the cpu moves to another task, samples that straddle a change are dropped
+extern uint32_t context_switches;
+
+#endif /* _LATENCY_H */
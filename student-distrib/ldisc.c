@@ -0,0 +1,221 @@
+/* ldisc.c
+ * Line discipline for the terminals. The keyboard irq only queues keys; on every
+ * PIT tick ldisc_run edits and echoes them and moves finished lines to the
+ * readers' buffer, so neither side of either ring takes a lock.
+ */
+
+#include "ldisc.h"
+#include "keyboard.h"
+#include "wait_queue.h"
+#include "lib.h"
+
+// Stores before it stay before it, the other side may look at the index right after
+#define barrier() asm volatile("" : : : "memory")
+
+/* ldisc_init()
+ * Input: line discipline to set up
+ * Return: none
+ * Effect: empty rings, canonical mode
+ */
+void ldisc_init(ldisc_t* ld) {
+	memset(ld, 0, sizeof(ldisc_t));
+	ld->mode = LDISC_CANONICAL;
+	ld->mode_task = -1;
+}
+
+/* ldisc_key()
+ * Input: displayed terminal's line discipline, key pressed or released
+ * Return: 0, -1 if the ring is full and the key was dropped
+ * Effect: Queues the key for the next ldisc_run. Only the keyboard irq calls this.
+ */
+int32_t ldisc_key(ldisc_t* ld, key_event_t ev) {
+	uint32_t head = ld->key_head;
+
+	if(head - ld->key_tail == KEY_RING_SIZE)
+		return -1;
+	ld->keys[head & (KEY_RING_SIZE - 1)] = ev;
+	barrier();
+	ld->key_head = head + 1;
+	return 0;
+}
+
+/* cooked_put()
+ * Input: line discipline, bytes finished for readers, how many
+ * Return: 0, -1 if they don't all fit and nothing was stored
+ * Effect: copies them into the cooked ring in at most two pieces
+ */
+static int32_t cooked_put(ldisc_t* ld, uint8_t* buf, uint32_t n) {
+	uint32_t head = ld->cooked_head;
+	uint32_t at = head & (LDISC_COOKED_SIZE - 1);
+	uint32_t first = LDISC_COOKED_SIZE - at;
+
+	if(LDISC_COOKED_SIZE - (head - ld->cooked_tail) < n)
+		return -1;
+	if(first > n)
+		first = n;
+	memcpy(ld->cooked + at, buf, first);
+	memcpy(ld->cooked, buf + first, n - first);
+	barrier();
+	ld->cooked_head = head + n;
+	return 0;
+}
+
+/* ldisc_input()
+ * Input: terminal id
+ * Return: 1 if readers have something new
+ * Effect: Edits, echoes and hands on the keys queued since the last tick. A
+ *			newline that doesn't fit yet stays queued until a reader makes room.
+ */
+static int32_t ldisc_input(uint32_t tid) {
+	ldisc_t* ld = &terminal[tid].ldisc;
+	uint32_t tail = ld->key_tail;
+	int32_t ready = 0;
+	key_event_t ev;
+	uint8_t c;
+
+	while(tail != ld->key_head) {
+		ev = ld->keys[tail & (KEY_RING_SIZE - 1)];
+		c = ev.ch;
+		if(ld->mode == LDISC_RAW) {
+			if(cooked_put(ld, (uint8_t*)&ev, sizeof(key_event_t)) == -1)
+				break;
+			ready = 1;
+		} else if(c == 0) {
+			//releases and keys that don't type anything only matter to raw readers
+		} else if(c == KEY_BACKSPACE) {
+			if(ld->line_len > 0) {
+				ld->line_len--;
+				terminal_backspace(tid);
+			}
+		} else if(c == '\n') {
+			ld->line[ld->line_len] = '\n';
+			if(cooked_put(ld, ld->line, ld->line_len + 1) == -1)
+				break;
+			ld->line_len = 0;
+			terminal_putc(tid, c);
+			ready = 1;
+		} else if(ld->line_len < LDISC_LINE_MAX - 1) {
+			//the last byte is kept for the newline
+			ld->line[ld->line_len++] = c;
+			terminal_putc(tid, c);
+		}
+		tail++;
+	}
+	barrier();
+	ld->key_tail = tail;
+	return ready;
+}
+
+/* ldisc_run()
+ * Input: none
+ * Return: none
+ * Effect: runs every terminal's queued keys, called on each PIT tick before the
+ *			screen is flushed so the echo shows up on the same tick
+ */
+void ldisc_run(void) {
+	uint32_t tid;
+
+	for(tid = 0; tid < TERMINAL_COUNT; tid++) {
+		if(ldisc_input(tid)) {
+			wake_up(&terminal[tid].read_queue);
+			poll_wake();
+		}
+	}
+}
+
+/* ldisc_read()
+ * Input: terminal id, buffer to fill, its size
+ * Return: bytes copied, -1 if a raw read has no room for one key_event_t
+ * Effect: Sleeps until there is input, unless the terminal is non-blocking and
+ *			0 comes back at once. In canonical mode a read stops after a newline
+ *			and what the buffer can't hold stays for the next read; in raw mode it
+ *			takes as many whole key events as fit.
+ */
+int32_t ldisc_read(uint32_t tid, uint8_t* buf, uint32_t nbytes) {
+	ldisc_t* ld = &terminal[tid].ldisc;
+	uint32_t flags, tail, avail, n, at, first;
+
+	if(nbytes == 0)
+		return 0;
+	if(ld->mode == LDISC_RAW && nbytes < sizeof(key_event_t))
+		return -1;
+	cli_and_save(flags);
+	while(ld->cooked_head == ld->cooked_tail) {
+		if(ld->nonblock) {
+			restore_flags(flags);
+			return 0;
+		}
+		sleep_on(&terminal[tid].read_queue);
+	}
+
+	tail = ld->cooked_tail;
+	avail = ld->cooked_head - tail;
+	if(nbytes > avail)
+		nbytes = avail;
+	n = nbytes;
+	if(ld->mode == LDISC_RAW)
+		n -= n % sizeof(key_event_t);
+	if(ld->mode == LDISC_CANONICAL) {
+		for(n = 0; n < nbytes; n++) {
+			if(ld->cooked[(tail + n) & (LDISC_COOKED_SIZE - 1)] == '\n') {
+				n++;
+				break;
+			}
+		}
+	}
+
+	at = tail & (LDISC_COOKED_SIZE - 1);
+	first = LDISC_COOKED_SIZE - at;
+	if(first > n)
+		first = n;
+	memcpy(buf, ld->cooked + at, first);
+	memcpy(buf + first, ld->cooked, n - first);
+	barrier();
+	ld->cooked_tail = tail + n;
+	restore_flags(flags);
+	return n;
+}
+
+/* ldisc_poll()
+ * Input: terminal id
+ * Return: POLLIN when a read would not sleep
+ * Effect: none, ldisc_run wakes pollers when input arrives
+ */
+int32_t ldisc_poll(uint32_t tid) {
+	ldisc_t* ld = &terminal[tid].ldisc;
+
+	return (ld->cooked_head != ld->cooked_tail) ? POLLIN : 0;
+}
+
+/* ldisc_set_mode()
+ * Input: terminal id, LDISC_CANONICAL or LDISC_RAW, 1 for non-blocking reads,
+ *			task asking for it
+ * Return: none
+ * Effect: Switches how keys are handed on from the next tick. Input finished for
+ *			the old mode is dropped, raw readers only ever see whole events. A half
+ *			edited line waits until the terminal is canonical again.
+ */
+void ldisc_set_mode(uint32_t tid, uint32_t mode, uint32_t nonblock, int32_t task) {
+	ldisc_t* ld = &terminal[tid].ldisc;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if(mode != ld->mode) {
+		ld->mode = mode;
+		ld->cooked_tail = ld->cooked_head;
+	}
+	ld->nonblock = nonblock;
+	ld->mode_task = (mode == LDISC_CANONICAL && !nonblock) ? -1 : task;
+	restore_flags(flags);
+}
+
+/* ldisc_task_exit()
+ * Input: terminal id, task that is halting
+ * Return: none
+ * Effect: puts the terminal back to blocking canonical input if that task changed
+ *			it, so the shell it returns to can read lines again
+ */
+void ldisc_task_exit(uint32_t tid, int32_t task) {
+	if(terminal[tid].ldisc.mode_task == task)
+		ldisc_set_mode(tid, LDISC_CANONICAL, 0, -1);
+}
@@ -0,0 +1,60 @@
+/* ldisc.h
+ */
+
+#ifndef _LDISC_H
+#define _LDISC_H
+
+#include "types.h"
+
+#define KEY_RING_SIZE 256				//power of 2, keys the irq can queue between two ticks
+#define LDISC_LINE_MAX 1024				//longest line being edited, the newline included
+#define LDISC_COOKED_SIZE 2048			//power of 2, bytes finished and waiting for readers
+
+// Line discipline modes
+#define LDISC_CANONICAL 0				//lines are edited and echoed, reads return whole lines
+#define LDISC_RAW 1						//every key goes to readers as typed, no echo or editing
+
+// Character the irq gives backspace
+#define KEY_BACKSPACE '\b'
+
+// key_event_t flags, the modifiers are the ones held when the key changed
+#define KEY_RELEASED 0x01
+#define KEY_SHIFT 0x02
+#define KEY_CTRL 0x04
+#define KEY_ALT 0x08
+#define KEY_CAPS 0x10
+
+// One press or release, raw mode reads return these whole
+typedef struct key_event_t {
+	uint8_t scancode;					//set 1 make code, the release bit cleared
+	uint8_t ch;							//character a press types, 0 for releases and other keys
+	uint8_t flags;
+	uint8_t pad;
+} key_event_t;
+
+// Input side of one terminal. Both rings have one producer and one consumer and
+// indices that count up forever: the keyboard irq fills keys and ldisc_run empties
+// it, ldisc_run fills cooked and readers empty it.
+typedef struct ldisc_t {
+	key_event_t keys[KEY_RING_SIZE];
+	volatile uint32_t key_head;			//moved only by the keyboard irq
+	volatile uint32_t key_tail;			//moved only by ldisc_run
+	uint8_t line[LDISC_LINE_MAX];		//line being edited in canonical mode
+	uint32_t line_len;
+	uint8_t cooked[LDISC_COOKED_SIZE];
+	volatile uint32_t cooked_head;		//moved only by ldisc_run
+	volatile uint32_t cooked_tail;		//moved only by readers
+	uint32_t mode;
+	uint32_t nonblock;					//1 if reads return 0 instead of sleeping when there is no input
+	int32_t mode_task;					//task that last changed the mode, -1 if it is the default
+} ldisc_t;
+
+void ldisc_init(ldisc_t* ld);
+int32_t ldisc_key(ldisc_t* ld, key_event_t ev);
+void ldisc_run(void);
+int32_t ldisc_read(uint32_t tid, uint8_t* buf, uint32_t nbytes);
+int32_t ldisc_poll(uint32_t tid);
+void ldisc_set_mode(uint32_t tid, uint32_t mode, uint32_t nonblock, int32_t task);
+void ldisc_task_exit(uint32_t tid, int32_t task);
+
+#endif /* _LDISC_H */
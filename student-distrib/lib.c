@@ -3,68 +3,479 @@
 
 #include "lib.h"
 #include "keyboard.h"
+#include "scrollback.h"
+#include "vt100.h"
 
 
-#define ATTRIB      0x7
+#define ATTRIB      VT_DEFAULT_ATTRIB
+#define BLANK       (' ' | (ATTRIB << 8))
+#define ALL_ROWS    ((1 << NUM_ROWS) - 1)
+// Bytes that end a run of plain text in terminal_puts
+#define RUN_STOP(c)             ((c) == '\n' || (c) == '\r' || (c) == VT_ESC)
+// Dirty bits of screen rows top to bottom
+#define ROW_MASK(top, bottom)   (((1 << ((bottom) + 1)) - 1) & ~((1 << (top)) - 1))
 
-static int screen_x;
-static int screen_y;
 static char* video_mem = (char *)VIDEO;
+static uint32_t crtc_start;         //cell the CRTC shows at the top of the screen
+
+/* uint16_t* terminal_row(terminal_t* t, int y);
+ * Inputs: t = terminal, y = row on its screen
+ * Return Value: that row of the terminal's backing buffer
+ * Function: rows are a ring starting at top_row, scrolling only moves top_row */
+static uint16_t* terminal_row(terminal_t* t, int y) {
+    return t->rows[(t->top_row + y) % NUM_ROWS];
+}
+
+/* uint16_t terminal_blank(terminal_t* t);
+ * Inputs: t = terminal
+ * Return Value: an empty cell in the terminal's current colors
+ * Function: erased and scrolled in cells keep the background SGR picked */
+static uint16_t terminal_blank(terminal_t* t) {
+    return ' ' | (t->vt.attrib << 8);
+}
+
+/* void terminal_scroll(terminal_t* t);
+ * Inputs: t = terminal
+ * Return Value: none
+ * Function: The old top row goes to the history and becomes the blank bottom
+ *   row. The rows already in video memory move up with the start address on
+ *   the next flush, so only their dirty bits move */
+static void terminal_scroll(terminal_t* t) {
+    scrollback_push(&t->history, terminal_row(t, 0), NUM_COLS, BLANK);
+    t->top_row = (t->top_row + 1) % NUM_ROWS;
+    memset_word(terminal_row(t, NUM_ROWS - 1), terminal_blank(t), NUM_COLS);
+    t->dirty = (t->dirty >> 1) | (1 << (NUM_ROWS - 1));
+    t->scrolled++;
+}
+
+/* void terminal_scroll_rows(terminal_t* t, uint32_t top, uint32_t bottom, int32_t n);
+ * Inputs: t = terminal, top/bottom = rows that move, inclusive,
+ *   n = lines to move them up, negative moves them down
+ * Return Value: none
+ * Function: Scrolls part of the screen, blanking the rows it uncovers. The whole
+ *   screen scrolling up only steps the row ring and keeps the history */
+static void terminal_scroll_rows(terminal_t* t, uint32_t top, uint32_t bottom, int32_t n) {
+    uint32_t height = bottom - top + 1, y, count;
+
+    count = (n < 0) ? -n : n;
+    if (count > height)
+        count = height;
+    if (n > 0 && top == 0 && bottom == NUM_ROWS - 1) {
+        while (count-- > 0)
+            terminal_scroll(t);
+        return;
+    }
+    if (n > 0) {
+        for (y = top; y + count <= bottom; y++)
+            memcpy(terminal_row(t, y), terminal_row(t, y + count), NUM_COLS * 2);
+        for (y = bottom + 1 - count; y <= bottom; y++)
+            memset_word(terminal_row(t, y), terminal_blank(t), NUM_COLS);
+    } else {
+        for (y = bottom; y >= top + count; y--)
+            memcpy(terminal_row(t, y), terminal_row(t, y - count), NUM_COLS * 2);
+        for (y = top; y < top + count; y++)
+            memset_word(terminal_row(t, y), terminal_blank(t), NUM_COLS);
+    }
+    t->dirty |= ROW_MASK(top, bottom);
+}
+
+/* void terminal_linefeed(terminal_t* t);
+ * Inputs: t = terminal
+ * Return Value: none
+ * Function: cursor down a row, scrolling the scroll region at its bottom */
+static void terminal_linefeed(terminal_t* t) {
+    if (t->cursor_pos_y == t->vt.scroll_bottom)
+        terminal_scroll_rows(t, t->vt.scroll_top, t->vt.scroll_bottom, 1);
+    else if (t->cursor_pos_y < NUM_ROWS - 1)
+        t->cursor_pos_y++;
+}
+
+/* void terminal_newline(terminal_t* t);
+ * Inputs: t = terminal
+ * Return Value: none
+ * Function: cursor to the start of the next row, scrolling at the bottom */
+static void terminal_newline(terminal_t* t) {
+    terminal_linefeed(t);
+    t->cursor_pos_x = 0;
+}
+
+/* void terminal_erase(terminal_t* t, uint32_t y, uint32_t from, uint32_t to);
+ * Inputs: t = terminal, y = screen row, from/to = columns to blank, to exclusive
+ * Return Value: none
+ * Function: blanks part of a row */
+static void terminal_erase(terminal_t* t, uint32_t y, uint32_t from, uint32_t to) {
+    memset_word(terminal_row(t, y) + from, terminal_blank(t), to - from);
+    t->dirty |= 1 << y;
+}
+
+/* void terminal_move(terminal_t* t, int32_t x, int32_t y);
+ * Inputs: t = terminal, x/y = where the cursor should go
+ * Return Value: none
+ * Function: moves the cursor, kept on the screen */
+static void terminal_move(terminal_t* t, int32_t x, int32_t y) {
+    if (x < 0)
+        x = 0;
+    if (x > NUM_COLS - 1)
+        x = NUM_COLS - 1;
+    if (y < 0)
+        y = 0;
+    if (y > NUM_ROWS - 1)
+        y = NUM_ROWS - 1;
+    t->cursor_pos_x = x;
+    t->cursor_pos_y = y;
+}
+
+/* void terminal_esc(terminal_t* t);
+ * Inputs: t = terminal whose parser finished an ESC sequence
+ * Return Value: none
+ * Function: carries out ESC 7, 8, D, E, M and c, other ones are ignored */
+static void terminal_esc(terminal_t* t) {
+    uint32_t y;
+
+    switch (t->vt.final) {
+        case '7':
+            t->vt.saved_x = t->cursor_pos_x;
+            t->vt.saved_y = t->cursor_pos_y;
+            break;
+        case '8':
+            terminal_move(t, t->vt.saved_x, t->vt.saved_y);
+            break;
+        case 'D':
+            terminal_linefeed(t);
+            break;
+        case 'E':
+            terminal_newline(t);
+            break;
+        case 'M':
+            //reverse index, the region scrolls down at its top
+            if (t->cursor_pos_y == t->vt.scroll_top)
+                terminal_scroll_rows(t, t->vt.scroll_top, t->vt.scroll_bottom, -1);
+            else if (t->cursor_pos_y > 0)
+                t->cursor_pos_y--;
+            break;
+        case 'c':
+            vt100_init(&t->vt);
+            for (y = 0; y < NUM_ROWS; y++)
+                terminal_erase(t, y, 0, NUM_COLS);
+            terminal_move(t, 0, 0);
+            break;
+    }
+}
+
+/* void terminal_csi(terminal_t* t);
+ * Inputs: t = terminal whose parser finished an ESC [ sequence
+ * Return Value: none
+ * Function: Carries out cursor movement (A-G, H, f, d, s, u), erasing (J, K),
+ *   colors (m), the scroll region (r), scrolling (S, T) and inserting and
+ *   deleting lines (L, M). Rows and columns in sequences count from 1 */
+static void terminal_csi(terminal_t* t) {
+    vt100_t* vt = &t->vt;
+    int32_t x = t->cursor_pos_x, y = t->cursor_pos_y;
+    uint32_t n = vt100_param(vt, 0, 1), top, bottom, i;
+
+    //ESC [ ? sequences switch modes this terminal does not have
+    if (vt->private)
+        return;
+
+    switch (vt->final) {
+        case 'A':
+            terminal_move(t, x, y - n);
+            break;
+        case 'B':
+            terminal_move(t, x, y + n);
+            break;
+        case 'C':
+            terminal_move(t, x + n, y);
+            break;
+        case 'D':
+            terminal_move(t, x - n, y);
+            break;
+        case 'E':
+            terminal_move(t, 0, y + n);
+            break;
+        case 'F':
+            terminal_move(t, 0, y - n);
+            break;
+        case 'G':
+            terminal_move(t, n - 1, y);
+            break;
+        case 'H':
+        case 'f':
+            terminal_move(t, vt100_param(vt, 1, 1) - 1, n - 1);
+            break;
+        case 'd':
+            terminal_move(t, x, n - 1);
+            break;
+        case 's':
+            vt->saved_x = x;
+            vt->saved_y = y;
+            break;
+        case 'u':
+            terminal_move(t, vt->saved_x, vt->saved_y);
+            break;
+        case 'J':
+            //0 cursor to end, 1 start to cursor, 2 the whole screen
+            switch (vt100_param(vt, 0, 0)) {
+                case 0:
+                    terminal_erase(t, y, x, NUM_COLS);
+                    for (i = y + 1; i < NUM_ROWS; i++)
+                        terminal_erase(t, i, 0, NUM_COLS);
+                    break;
+                case 1:
+                    for (i = 0; i < y; i++)
+                        terminal_erase(t, i, 0, NUM_COLS);
+                    terminal_erase(t, y, 0, x + 1);
+                    break;
+                case 2:
+                    for (i = 0; i < NUM_ROWS; i++)
+                        terminal_erase(t, i, 0, NUM_COLS);
+                    break;
+            }
+            break;
+        case 'K':
+            switch (vt100_param(vt, 0, 0)) {
+                case 0:
+                    terminal_erase(t, y, x, NUM_COLS);
+                    break;
+                case 1:
+                    terminal_erase(t, y, 0, x + 1);
+                    break;
+                case 2:
+                    terminal_erase(t, y, 0, NUM_COLS);
+                    break;
+            }
+            break;
+        case 'm':
+            vt100_sgr(vt);
+            break;
+        case 'r':
+            top = vt100_param(vt, 0, 1) - 1;
+            bottom = vt100_param(vt, 1, NUM_ROWS) - 1;
+            if (bottom > NUM_ROWS - 1)
+                bottom = NUM_ROWS - 1;
+            if (top >= bottom)
+                break;
+            vt->scroll_top = top;
+            vt->scroll_bottom = bottom;
+            terminal_move(t, 0, 0);
+            break;
+        case 'S':
+            terminal_scroll_rows(t, vt->scroll_top, vt->scroll_bottom, n);
+            break;
+        case 'T':
+            terminal_scroll_rows(t, vt->scroll_top, vt->scroll_bottom, -(int32_t)n);
+            break;
+        case 'L':
+        case 'M':
+            //only inside the scroll region, the rows below the cursor move
+            if (y < vt->scroll_top || y > vt->scroll_bottom)
+                break;
+            terminal_scroll_rows(t, y, vt->scroll_bottom, (vt->final == 'L') ? -(int32_t)n : (int32_t)n);
+            t->cursor_pos_x = 0;
+            break;
+    }
+}
+
+/* void terminal_byte(terminal_t* t, uint8_t c);
+ * Inputs: t = terminal, c = byte written to it
+ * Return Value: none
+ * Function: prints the byte or feeds it to the escape parser, callers keep interrupts off */
+static void terminal_byte(terminal_t* t, uint8_t c) {
+    switch (vt100_feed(&t->vt, c)) {
+        case VT_PRINT:
+            if (c == '\n' || c == '\r') {
+                terminal_newline(t);
+                break;
+            }
+            terminal_row(t, t->cursor_pos_y)[t->cursor_pos_x] = c | (t->vt.attrib << 8);
+            t->dirty |= 1 << t->cursor_pos_y;
+            if (t->cursor_pos_x == NUM_COLS - 1)
+                terminal_newline(t);
+            else
+                t->cursor_pos_x++;
+            break;
+        case VT_ESC_DONE:
+            terminal_esc(t);
+            break;
+        case VT_CSI_DONE:
+            terminal_csi(t);
+            break;
+    }
+}
+
+/* uint16_t* terminal_window_row(uint32_t tid, uint32_t y);
+ * Inputs: tid = terminal, y = row on its screen
+ * Return Value: where that row sits in video memory
+ * Function: each terminal draws in its own VGA_WINDOW, from its vga_top row on */
+static uint16_t* terminal_window_row(uint32_t tid, uint32_t y) {
+    return (uint16_t*)(video_mem + tid * VGA_WINDOW) + (terminal[tid].vga_top + y) * NUM_COLS;
+}
+
+/* void terminal_flush(uint32_t tid);
+ * Inputs: tid = terminal
+ * Return Value: none
+ * Function: Moves the window past the lines the terminal scrolled, starting it
+ *   over with a full repaint once it runs out of rows, then copies the changed
+ *   rows in. Callers keep interrupts off */
+static void terminal_flush(uint32_t tid) {
+    terminal_t* t = &terminal[tid];
+    uint32_t line;
+    int y;
+
+    if (t->scrolled != 0) {
+        if (t->vga_pinned || t->vga_top + t->scrolled + NUM_ROWS > VGA_ROWS) {
+            t->vga_top = 0;
+            t->dirty = ALL_ROWS;
+        } else {
+            t->vga_top += t->scrolled;
+        }
+        t->scrolled = 0;
+    }
+    if (t->history.view != 0) {
+        //scrolled back, the history lines sit on top of what is left of the live screen
+        for (y = 0; t->dirty != 0 && y < NUM_ROWS; y++) {
+            line = t->history.count - t->history.view + y;
+            if (line < t->history.count)
+                scrollback_line(&t->history, line, terminal_window_row(tid, y), NUM_COLS, BLANK);
+            else
+                memcpy(terminal_window_row(tid, y), terminal_row(t, line - t->history.count), NUM_COLS * 2);
+        }
+        t->dirty = 0;
+    }
+    for (y = 0; t->dirty != 0 && y < NUM_ROWS; y++) {
+        if (t->dirty & (1 << y)) {
+            memcpy(terminal_window_row(tid, y), terminal_row(t, y), NUM_COLS * 2);
+            t->dirty &= ~(1 << y);
+        }
+    }
+}
 
 /* void clear(void);
  * Inputs: void
  * Return Value: none
- * Function: Clears video memory */
+ * Function: Clears the displayed terminal, the screen catches up on the next flush */
 void clear(void) {
-    int32_t i;
-    for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
-    }
-
+    terminal_t* t = &terminal[display_terminal_id];
+    memset_word(t->rows, BLANK, NUM_ROWS * NUM_COLS);
+    t->top_row = 0;
+    t->dirty = ALL_ROWS;
 }
 /* void scroll_up(void);
  * Inputs: void
  * Return Value: none
- * Function: apply scrolling effect */
+ * Function: apply scrolling effect to the displayed terminal */
 void scroll_up( void){
-  //move mem up by a row
-  memmove(video_mem, video_mem+ NUM_COLS*2, NUM_COLS*(NUM_ROWS-1)*2);
-  int i;
-  // clear last line
-  for (i = 0; i < NUM_COLS; i++){
-    *(uint8_t* ) (video_mem + (NUM_COLS *(NUM_ROWS-1) + i)*2 ) = ' ';
-  }
-  screen_x = 0;
-  screen_y = 24;
-
+  terminal_scroll(&terminal[display_terminal_id]);
+}
+/* void screen_flush(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: copy every terminal's changed rows into its window of video memory
+ *   and point the screen at the displayed one, called on every PIT tick so a
+ *   burst of output costs one repaint */
+void screen_flush(void) {
+    uint32_t flags, tid;
+
+    cli_and_save(flags);
+    for (tid = 0; tid < TERMINAL_COUNT; tid++)
+        terminal_flush(tid);
+    screen_show();
+    restore_flags(flags);
+}
+/* void screen_show(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: sets the CRTC start address to the displayed terminal's window,
+ *   the ports are only written when it moved */
+void screen_show(void) {
+    uint32_t start = display_terminal_id * (VGA_WINDOW / 2) + terminal[display_terminal_id].vga_top * NUM_COLS;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (start != crtc_start) {
+        outb(CRTC_START_HIGH, CRTC_INDEX);
+        outb((start >> 8) & 0xFF, CRTC_DATA);
+        outb(CRTC_START_LOW, CRTC_INDEX);
+        outb(start & 0xFF, CRTC_DATA);
+        crtc_start = start;
+    }
+    restore_flags(flags);
+}
+/* void screen_pin(uint32_t tid, uint32_t pin);
+ * Inputs: tid = terminal, pin = 1 while a vidmap program draws in its window
+ * Return Value: none
+ * Function: A pinned window stays at its first row so the page vidmap hands out
+ *   is the screen. Scrolling it repaints the window like before page flipping */
+void screen_pin(uint32_t tid, uint32_t pin) {
+    terminal_t* t = &terminal[tid];
+    uint32_t flags;
+
+    cli_and_save(flags);
+    t->vga_pinned = pin;
+    if (pin && t->vga_top != 0) {
+        //the program starts drawing right away, put the text where it will see it now
+        t->vga_top = 0;
+        t->dirty = ALL_ROWS;
+        terminal_flush(tid);
+        screen_show();
+    }
+    restore_flags(flags);
+}
+/* void screen_scroll(int32_t lines);
+ * Inputs: lines = how far further back into the displayed terminal's history to
+ *   look, negative moves toward the live screen
+ * Return Value: none
+ * Function: moves the view, the next flush repaints it */
+void screen_scroll(int32_t lines) {
+    terminal_t* t = &terminal[display_terminal_id];
+    int32_t view;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    view = t->history.view + lines;
+    if (view < 0)
+        view = 0;
+    if (view > t->history.count)
+        view = t->history.count;
+    if (view != t->history.view) {
+        t->history.view = view;
+        t->dirty = ALL_ROWS;
+    }
+    restore_flags(flags);
 }
 int getYpos(void ){
-  return screen_y;
+  return terminal[display_terminal_id].cursor_pos_y;
 }
 void setScreenPos ( int x, int y){
-  screen_x = x;
-  screen_y = y;
+  terminal[display_terminal_id].cursor_pos_x = x;
+  terminal[display_terminal_id].cursor_pos_y = y;
 }
-/* void backspace(void);
- * Inputs: void
+/* void terminal_backspace(uint32_t tid);
+ * Inputs: tid = terminal
  * Return Value: none
- * Function: decrease screen_x*/
-void back_space( void ){
-  screen_x --;
+ * Function: rubs out the character before a terminal's cursor, going onto the
+ *   end of the row above when a typed line had wrapped */
+void terminal_backspace(uint32_t tid){
+  terminal_t* t = &terminal[tid];
+  uint32_t flags;
+
+  cli_and_save(flags);
+  if (t->cursor_pos_x > 0)
+    t->cursor_pos_x --;
+  else if (t->cursor_pos_y > 0) {
+    t->cursor_pos_x = NUM_COLS - 1;
+    t->cursor_pos_y --;
+  }
+  terminal_row(t, t->cursor_pos_y)[t->cursor_pos_x] = terminal_blank(t);
+  t->dirty |= 1 << t->cursor_pos_y;
+  restore_flags(flags);
 }
 /* void reset_position(void);
  * Inputs: void
  * Return Value: none
  * Function: Sets print location to start of screen */
 void reset_position(void) {
-	screen_x = 0;
-	screen_y = 0;
-}
-
-void cpy_screen_pos(void){
-    terminal[display_terminal_id].cursor_pos_x= screen_x;
-    terminal[display_terminal_id].cursor_pos_y= screen_y;
+	setScreenPos(0, 0);
 }
 
 /* Standard printf().
@@ -209,33 +620,64 @@ int32_t puts(int8_t* s) {
 /* void putc(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- *  Function: Output a character to the console */
+ *  Function: Output a character to the displayed terminal */
 void putc(uint8_t c) {
-    if(c == '\n' || c == '\r') {
-      if (screen_y == NUM_ROWS -1){
-        scroll_up();
-      }
-      else {
-        screen_y++;
-        screen_x = 0;
-      }
-    } else {
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = ATTRIB;
-        if (screen_x == NUM_COLS-1){
-          screen_x = 0;
-          if (screen_y == NUM_ROWS -1){
-            scroll_up();
-          }
-          else
-            screen_y++;
-        }
-        else
-          screen_x++;
-        // screen_x %= NUM_COLS;
-        // screen_y = (screen_y + (screen_x / NUM_COLS)) % NUM_ROWS;
+    terminal_putc(display_terminal_id, c);
+}
 
+/* void terminal_putc(uint32_t tid, uint8_t c);
+ * Inputs: tid = terminal to print on, c = character to print
+ * Return Value: void
+ *  Function: Output a character at a terminal's own cursor, shown or not */
+void terminal_putc(uint32_t tid, uint8_t c) {
+    terminal_t* t = &terminal[tid];
+    uint32_t flags;
+
+    //keyboard echo prints on the same terminal from its interrupt
+    cli_and_save(flags);
+    terminal_byte(t, c);
+    restore_flags(flags);
+}
+
+/* int32_t terminal_puts(uint32_t tid, const int8_t* buf, uint32_t n);
+ * Inputs: tid = terminal to print on, buf = bytes to print, n = how many
+ * Return Value: n
+ * Function: Output a buffer at a terminal's cursor. Plain text is split at
+ *   newlines and row ends and each run is stored into its row in one loop,
+ *   escape sequences and newlines go through terminal_byte */
+int32_t terminal_puts(uint32_t tid, const int8_t* buf, uint32_t n) {
+    terminal_t* t = &terminal[tid];
+    uint32_t done = 0, end, run, i, flags;
+    uint16_t* cell;
+
+    while (done < n) {
+        //interrupts come back on between chunks of a long write
+        end = done + TERMINAL_CHUNK;
+        if (end > n)
+            end = n;
+
+        cli_and_save(flags);
+        while (done < end) {
+            if (t->vt.state != VT_GROUND || RUN_STOP(buf[done])) {
+                terminal_byte(t, buf[done]);
+                done++;
+                continue;
+            }
+            run = NUM_COLS - t->cursor_pos_x;
+            if (run > end - done)
+                run = end - done;
+            cell = terminal_row(t, t->cursor_pos_y) + t->cursor_pos_x;
+            for (i = 0; i < run && !RUN_STOP(buf[done + i]); i++)
+                cell[i] = (uint8_t) buf[done + i] | (t->vt.attrib << 8);
+            t->dirty |= 1 << t->cursor_pos_y;
+            done += i;
+            t->cursor_pos_x += i;
+            if (t->cursor_pos_x == NUM_COLS)
+                terminal_newline(t);
+        }
+        restore_flags(flags);
     }
+    return n;
 }
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
@@ -9,9 +9,17 @@
 #define NUM_COLS    80
 #define NUM_ROWS    25
 #define VIDEO       0xB8000
+#define VGA_WINDOW  8192                            //bytes of VGA text memory each terminal draws in
+#define VGA_ROWS    (VGA_WINDOW / (NUM_COLS * 2))   //rows a window holds, the screen shows NUM_ROWS of them
+#define CRTC_INDEX  0x3D4
+#define CRTC_DATA   0x3D5
+#define CRTC_START_HIGH 0x0C                        //cell the screen starts at, high and low bytes
+#define CRTC_START_LOW  0x0D
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
+void terminal_putc(uint32_t tid, uint8_t c);
+int32_t terminal_puts(uint32_t tid, const int8_t* buf, uint32_t n);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t *strrev(int8_t* s);
@@ -20,9 +28,12 @@ void clear(void);
 int getYpos(void );
 void scroll_up(void);
 void setScreenPos ( int x, int y);
-void back_space( void );
+void terminal_backspace(uint32_t tid);
 void reset_position(void);
-void cpy_screen_pos(void);
+void screen_flush(void);
+void screen_show(void);
+void screen_pin(uint32_t tid, uint32_t pin);
+void screen_scroll(int32_t lines);
 
 void* memset(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
@@ -1,8 +1,10 @@
 #include "paging.h"
+#include "frame.h"
 
 uint32_t page_directory [oneK] __attribute__((aligned (fourK)));
 uint32_t page_table [oneK] __attribute__((aligned (fourK)));
 uint32_t video_page [oneK] __attribute__((aligned (fourK)));
+uint32_t vdso_table [oneK] __attribute__((aligned (fourK)));
 
 /*
 function: paging_init()
@@ -10,10 +12,11 @@ effects: initialize paging for kernel and Userspace
 */
 void paging_init(){
   int i;
+  uint32_t addr;
   for (i = 0; i < oneK; i++){
     page_directory[i] = 0x2; //RW enabled, not present
 
-    if (i == video_mem_offset)
+    if (i >= video_mem_offset && i < video_mem_offset + video_mem_pages)
       page_table[i] = i * fourK | 0x3;  // RW enabled, present, supervisor
     else
       page_table[i] = i* fourK | 0x2; // RW enabled, not present
@@ -23,8 +26,12 @@ void paging_init(){
   page_directory[0] = (uint32_t) page_table | 0x3;
   //4M start addr, RW enabled, present, 4mb page
   page_directory[1] = oneK* fourK | 0x83;
+  //identity map the frame pool for the kernel, supervisor, RW enabled, present, 4mb pages
+  for (addr = eightM; addr < frame_pool_top(); addr += fourM)
+    page_directory[addr / fourM] = addr | 0x83;
 
-  /* initialize required regs for paging */
+  /* initialize required regs for paging, write protect (cr0 bit 16) makes
+     kernel writes to copy on write pages fault like user writes do */
   //paging startup
   asm volatile(
     "movl %%cr4, %%eax \n"
@@ -33,7 +40,7 @@ void paging_init(){
     "movl %0, %%eax \n"
     "movl %%eax, %%cr3  \n"
     "movl %%cr0, %%eax \n"
-    "orl $0x80000000, %%eax \n"
+    "orl $0x80010000, %%eax \n"
     "movl %%eax, %%cr0 \n "
     :
     :"r" (page_directory)
@@ -44,14 +51,68 @@ void paging_init(){
 }
 /*
 function: syscall_paging_setup
-input: physical address to map to virtual address
+input: the task's user page table
 output: None
-effect: setup paging for execute and halt
+effect: setup paging for execute, halt and the scheduler, the 128MB program
+  page is backed by the task's 4kb page table
 */
-void syscall_paging_setup(uint32_t addr){
+void syscall_paging_setup(uint32_t* table){
   uint32_t i;
   i = virtual_mem / fourM;
-  page_directory[i] = addr | 0x87 ; // user, R/w, present, 4MB page;
+  page_directory[i] = (uint32_t) table | 0x7 ; // user, R/w, present, 4kb page table;
+  flush_TLB();
+}
+/* user_pages_init
+ * Input: uint32_t* table
+ * Returns: void
+ * Effect: mark every page of a task's program page not present, so they
+    are filled in by the page fault handler on first touch
+ */
+void user_pages_init(uint32_t* table){
+  uint32_t j;
+  for (j = 0; j < oneK; j++)
+    table[j] = 0x6; // user_level, R/W, not present
+}
+/* user_page_map
+ * Input: uint32_t* table, uint32_t page, uint32_t physical
+ * Returns: void
+ * Effect: back one 4kb page of a task's program page with physical memory.
+    Not present entries are never cached, so no TLB flush is needed
+ */
+void user_page_map(uint32_t* table, uint32_t page, uint32_t physical){
+  table[page] = physical | 0x7; // user_level, R/W, present
+}
+/* user_pages_free
+ * Input: uint32_t* table
+ * Returns: void
+ * Effect: give every frame backing a task's program page back to the
+    frame allocator and mark the pages not present
+ */
+void user_pages_free(uint32_t* table){
+  uint32_t j;
+  for (j = 0; j < oneK; j++){
+    if (table[j] & 0x1)
+      frame_free(table[j] & ~(fourK - 1));
+    table[j] = 0x6; // user_level, R/W, not present
+  }
+}
+/* user_pages_share
+ * Input: uint32_t* parent, uint32_t* child
+ * Returns: void
+ * Effect: fill a forked task's program page with the parent's frames. Writable
+    pages become read only copy on write in both tables, each shared frame
+    gets one more reference. The parent's table may be live, so flush
+ */
+void user_pages_share(uint32_t* parent, uint32_t* child){
+  uint32_t j;
+  for (j = 0; j < oneK; j++){
+    if (parent[j] & 0x1){
+      if (parent[j] & 0x2)
+        parent[j] = (parent[j] & ~0x2) | PAGE_COW; // user_level, read only, present, cow
+      frame_ref(parent[j] & ~(fourK - 1));
+    }
+    child[j] = parent[j];
+  }
   flush_TLB();
 }
 /* videomem_map
@@ -84,6 +145,60 @@ void videomem_unmap(uint32_t virtual, uint32_t physical){
   page_directory[i] = 0x02; // not present
   flush_TLB();
 }
+/* vdso_page_map
+ * Input: uint32_t virtual, uint32_t physical
+ * Returns: void
+ * Effect: map the kernel's time page read only for every task. It
+    lives in the shared page directory, so it never changes on a switch
+ */
+void vdso_page_map(uint32_t virtual, uint32_t physical){
+  uint32_t i = virtual / fourM;
+  uint32_t j;
+  for (j = 0; j < oneK; j++)
+    vdso_table[j] = 0x4; // user_level, not present
+  vdso_table[0] = physical | 0x5; // user_level, read only, present
+  page_directory[i] = (uint32_t) vdso_table | 0x7; // user_level, R/W, present, the pte makes it read only
+  flush_TLB();
+}
+/* file_page_map
+ * Input: uint32_t* table, uint32_t page, uint32_t physical
+ * Returns: void
+ * Effect: point a page of a task's file mapping at a 4kb block of the
+    boot module, user level and read only
+ */
+void file_page_map(uint32_t* table, uint32_t page, uint32_t physical){
+  table[page] = physical | 0x5; // user_level, read only, present
+}
+/* file_pages_clear
+ * Input: uint32_t* table
+ * Returns: void
+ * Effect: mark every page of a task's file mapping not present
+ */
+void file_pages_clear(uint32_t* table){
+  uint32_t j;
+  for (j = 0; j < oneK; j++)
+    table[j] = 0x4; // user_level, not present
+}
+/* file_pages_load
+ * Input: uint32_t* table
+ * Returns: void
+ * Effect: make a task's file mapping visible at 152MB
+ */
+void file_pages_load(uint32_t* table){
+  uint32_t i = _152MB / fourM;
+  page_directory[i] = (uint32_t) table | 0x7; // user_level, R/W, present, ptes make it read only
+  flush_TLB();
+}
+/* file_pages_unload
+ * Input: none
+ * Returns: void
+ * Effect: remove the file mapping at 152MB
+ */
+void file_pages_unload(void){
+  uint32_t i = _152MB / fourM;
+  page_directory[i] = 0x02; // not present
+  flush_TLB();
+}
 /*
 function: flush_TLB
 effects: refresh paging, for new settings to work
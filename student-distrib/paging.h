@@ -6,8 +6,11 @@
 #define eightM 0x800000
 #define video_mem_offset 0xb8
 #define video_mem_addr 0xb8000 
+#define video_mem_pages 8         //0xB8000-0xBFFFF, the text windows of every terminal
 #define virtual_mem 0x8000000
 #define _148MB 0x9400000
+#define _152MB 0x9800000
+#define PAGE_COW 0x200            //available pte bit, read only page shared by fork, copied on the first write
 
 
 
@@ -18,7 +21,16 @@ extern uint32_t video_page [oneK] __attribute__((aligned (fourK)));
 
 /*functions*/
 void paging_init();
-void syscall_paging_setup(uint32_t addr);
+void syscall_paging_setup(uint32_t* table);
+void user_pages_init(uint32_t* table);
+void user_page_map(uint32_t* table, uint32_t page, uint32_t physical);
+void user_pages_free(uint32_t* table);
+void user_pages_share(uint32_t* parent, uint32_t* child);
 void flush_TLB (void) ;
 void videomem_map(uint32_t virtual, uint32_t physical);
 void videomem_unmap(uint32_t virtual, uint32_t physical);
+void vdso_page_map(uint32_t virtual, uint32_t physical);
+void file_page_map(uint32_t* table, uint32_t page, uint32_t physical);
+void file_pages_clear(uint32_t* table);
+void file_pages_load(uint32_t* table);
+void file_pages_unload(void);
@@ -0,0 +1,264 @@
+/* pipe.c
+ * Kernel byte rings that carry one task's output into another task's input
+ */
+
+#include "pipe.h"
+#include "frame.h"
+#include "lib.h"
+#include "system_call.h"
+#include "wait_queue.h"
+
+pipe_t pipes[PIPE_MAX];
+
+// fds on the read end can only read, fds on the write end can only write
+fops_table_t pipe_read_fops = {
+	.open = NULL,
+	.close = pipe_read_close,
+	.read = pipe_read,
+	.write = NULL,
+	.dup = pipe_read_dup,
+	.poll = pipe_read_poll
+};
+
+fops_table_t pipe_write_fops = {
+	.open = NULL,
+	.close = pipe_write_close,
+	.read = NULL,
+	.write = pipe_write,
+	.dup = pipe_write_dup,
+	.poll = pipe_write_poll
+};
+
+/* pipe_get()
+ * Input: pipe index from an fd
+ * Return: the pipe, NULL on a bad index or a free pipe
+ * Effect: none
+ */
+static pipe_t* pipe_get(int32_t i) {
+	if((i < 0) || (i >= PIPE_MAX) || (pipes[i].buf == NULL))
+		return NULL;
+	return &pipes[i];
+}
+
+/* pipe_release()
+ * Input: pipe that lost an fd
+ * Return: none
+ * Effect: Wakes whoever waits on the other end so it sees the change, frees
+ *			the pipe once neither end is open. Interrupts must be off.
+ */
+static void pipe_release(pipe_t* pipe) {
+	wake_up(&pipe->read_queue);
+	wake_up(&pipe->write_queue);
+	poll_wake();
+	if((pipe->readers == 0) && (pipe->writers == 0)) {
+		frame_free((uint32_t)pipe->buf);
+		pipe->buf = NULL;
+	}
+}
+
+/* pipe_alloc()
+ * Input: none
+ * Return: index of a new empty pipe with one reader and one writer,
+ *			-1 if every pipe is in use or no frame is left
+ * Effect: takes a frame for the pipe's data
+ */
+int32_t pipe_alloc(void) {
+	uint32_t i, frame, flags;
+
+	frame = frame_alloc();
+	if(frame == 0)
+		return -1;
+	cli_and_save(flags);
+	for(i = 0; i < PIPE_MAX; i++) {
+		if(pipes[i].buf == NULL) {
+			pipes[i].buf = (uint8_t*)frame;
+			pipes[i].head = 0;
+			pipes[i].tail = 0;
+			pipes[i].readers = 1;
+			pipes[i].writers = 1;
+			wait_queue_init(&pipes[i].read_queue);
+			wait_queue_init(&pipes[i].write_queue);
+			restore_flags(flags);
+			return i;
+		}
+	}
+	restore_flags(flags);
+	frame_free(frame);
+	return -1;
+}
+
+/* pipe_read()
+ * Input: fd holding the pipe index, unused position, buffer to fill, its size
+ * Return: bytes read, 0 once the pipe is empty and no write end is open,
+ *			-1 on a bad fd or buffer
+ * Effect: Sleeps while the pipe is empty and still has a writer, then takes
+ *			whatever is there up to nbytes and wakes the writers.
+ */
+int32_t pipe_read(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes) {
+	pipe_t* pipe = pipe_get(*fd);
+	uint32_t flags, n, at, first;
+
+	if((pipe == NULL) || (buf == NULL))
+		return -1;
+	if(nbytes == 0)
+		return 0;
+
+	cli_and_save(flags);
+	while(pipe->head == pipe->tail) {
+		if(pipe->writers == 0) {
+			restore_flags(flags);
+			return 0;
+		}
+		sleep_on(&pipe->read_queue);
+	}
+
+	n = pipe->head - pipe->tail;
+	if(n > nbytes)
+		n = nbytes;
+	at = pipe->tail & (PIPE_SIZE - 1);
+	first = PIPE_SIZE - at;
+	if(first > n)
+		first = n;
+	memcpy(buf, pipe->buf + at, first);
+	memcpy(buf + first, pipe->buf, n - first);
+	pipe->tail += n;
+
+	wake_up(&pipe->write_queue);
+	poll_wake();
+	restore_flags(flags);
+	return n;
+}
+
+/* pipe_write()
+ * Input: fd holding the pipe index, unused position, data to send, its size
+ * Return: bytes written, -1 on a bad fd or buffer or if no read end is open
+ * Effect: Copies in as much as fits and sleeps while the pipe is full until
+ *			everything is in. Stops early if the last reader goes away.
+ */
+int32_t pipe_write(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes) {
+	pipe_t* pipe = pipe_get(*fd);
+	uint32_t flags, done, n, at, first;
+
+	if((pipe == NULL) || (buf == NULL))
+		return -1;
+
+	cli_and_save(flags);
+	done = 0;
+	while((done < nbytes) && (pipe->readers != 0)) {
+		n = PIPE_SIZE - (pipe->head - pipe->tail);
+		if(n == 0) {
+			sleep_on(&pipe->write_queue);
+			continue;
+		}
+		if(n > nbytes - done)
+			n = nbytes - done;
+		at = pipe->head & (PIPE_SIZE - 1);
+		first = PIPE_SIZE - at;
+		if(first > n)
+			first = n;
+		memcpy(pipe->buf + at, buf + done, first);
+		memcpy(pipe->buf, buf + done + first, n - first);
+		pipe->head += n;
+		done += n;
+
+		wake_up(&pipe->read_queue);
+		poll_wake();
+	}
+	restore_flags(flags);
+
+	if((done == 0) && (nbytes != 0))
+		return -1;
+	return done;
+}
+
+/* pipe_read_close()
+ * Input: fd holding the pipe index
+ * Return: 0 on success, -1 on a bad fd
+ * Effect: drops a reader, writers waiting for room fail once the last one is gone
+ */
+int32_t pipe_read_close(int32_t* fd) {
+	pipe_t* pipe = pipe_get(*fd);
+	uint32_t flags;
+
+	if(pipe == NULL)
+		return -1;
+	cli_and_save(flags);
+	pipe->readers--;
+	pipe_release(pipe);
+	restore_flags(flags);
+	return 0;
+}
+
+/* pipe_write_close()
+ * Input: fd holding the pipe index
+ * Return: 0 on success, -1 on a bad fd
+ * Effect: drops a writer, readers see the end of the data once the last one is gone
+ */
+int32_t pipe_write_close(int32_t* fd) {
+	pipe_t* pipe = pipe_get(*fd);
+	uint32_t flags;
+
+	if(pipe == NULL)
+		return -1;
+	cli_and_save(flags);
+	pipe->writers--;
+	pipe_release(pipe);
+	restore_flags(flags);
+	return 0;
+}
+
+/* pipe_read_dup()
+ * Input: pipe index to share, ptr to store the index for the new fd in
+ * Return: 0 on success, -1 on a bad index
+ * Effect: the new fd reads from the same pipe
+ */
+int32_t pipe_read_dup(int32_t old_i, int32_t* new_i) {
+	pipe_t* pipe = pipe_get(old_i);
+
+	if(pipe == NULL)
+		return -1;
+	pipe->readers++;
+	*new_i = old_i;
+	return 0;
+}
+
+/* pipe_write_dup()
+ * Input: pipe index to share, ptr to store the index for the new fd in
+ * Return: 0 on success, -1 on a bad index
+ * Effect: the new fd writes into the same pipe
+ */
+int32_t pipe_write_dup(int32_t old_i, int32_t* new_i) {
+	pipe_t* pipe = pipe_get(old_i);
+
+	if(pipe == NULL)
+		return -1;
+	pipe->writers++;
+	*new_i = old_i;
+	return 0;
+}
+
+/* pipe_read_poll()
+ * Input: fd holding the pipe index, unused position
+ * Return: POLLIN when there is data or no writer is left, POLLNVAL on a bad fd
+ * Effect: none, writes and closes call poll_wake
+ */
+int32_t pipe_read_poll(int32_t* fd, uint32_t* i) {
+	pipe_t* pipe = pipe_get(*fd);
+
+	if(pipe == NULL)
+		return POLLNVAL;
+	return ((pipe->head != pipe->tail) || (pipe->writers == 0)) ? POLLIN : 0;
+}
+
+/* pipe_write_poll()
+ * Input: fd holding the pipe index, unused position
+ * Return: POLLOUT when there is room or no reader is left, POLLNVAL on a bad fd
+ * Effect: none, reads and closes call poll_wake
+ */
+int32_t pipe_write_poll(int32_t* fd, uint32_t* i) {
+	pipe_t* pipe = pipe_get(*fd);
+
+	if(pipe == NULL)
+		return POLLNVAL;
+	return ((pipe->head - pipe->tail != PIPE_SIZE) || (pipe->readers == 0)) ? POLLOUT : 0;
+}
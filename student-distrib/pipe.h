@@ -0,0 +1,41 @@
+/* pipe.h
+ */
+
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+#include "system_call.h"
+#include "wait_queue.h"
+
+// Pipes open at once over all tasks
+#define PIPE_MAX 16
+// Bytes a pipe holds, one frame, power of 2 so the indices run freely and wrap with a mask
+#define PIPE_SIZE 4096
+
+// A byte ring between tasks, the index of the pipe is kept in the fd's inode field
+typedef struct pipe_t {
+	uint8_t* buf;						//frame holding the data, NULL while the pipe is free
+	uint32_t head;						//bytes ever written
+	uint32_t tail;						//bytes ever read
+	uint32_t readers;					//fds open on the read end
+	uint32_t writers;					//fds open on the write end
+	wait_queue_t read_queue;			//readers sleeping on an empty pipe
+	wait_queue_t write_queue;			//writers sleeping on a full pipe
+} pipe_t;
+
+int32_t pipe_alloc(void);
+int32_t pipe_read(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes);
+int32_t pipe_write(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes);
+int32_t pipe_read_close(int32_t* fd);
+int32_t pipe_write_close(int32_t* fd);
+int32_t pipe_read_dup(int32_t old_i, int32_t* new_i);
+int32_t pipe_write_dup(int32_t old_i, int32_t* new_i);
+int32_t pipe_read_poll(int32_t* fd, uint32_t* i);
+int32_t pipe_write_poll(int32_t* fd, uint32_t* i);
+
+extern fops_table_t pipe_read_fops;
+extern fops_table_t pipe_write_fops;
+extern pipe_t pipes[PIPE_MAX];
+
+#endif /* _PIPE_H */
@@ -5,8 +5,11 @@
 #include "i8259.h"
 #include "lib.h"
 #include "scheduler.h"
+#include "vdso.h"
+#include "ldisc.h"
 
-int i = 0;
+// Interrupts since boot, poll timeouts count these
+uint32_t pit_ticks;
 
 /* pit_init()
  * Input: none
@@ -34,19 +37,20 @@ void pit_init() {
 /* pit_handler()
  * Input: none
  * Return: none
- * Effect: Called when PIT signals interrupt, sends eoi to PIC
+ * Effect: Called when PIT signals interrupt, sends eoi to PIC and lets the scheduler
+ *			switch to the next task. Interrupts stay off until the handler irets.
  */
 void pit_handler() {
-	cli();
-	//round robin through three terminals
-	scheduler(i);
-	i++;
-	if(i > 2)
-		i = 0;
-	sti();
-	// Signal interrupt ended when finished handling
+	// Signal interrupt ended first, the scheduler may not return here until much later
 	send_eoi(PIT_IRQ_NUM);
+	pit_ticks++;
+	vdso_pit_tick();
+	poll_tick();
+	//edit and echo the keys typed since the last tick
+	ldisc_run();
+	//push what the terminals printed since the last tick to the screen
+	screen_flush();
+	//round robin through the running tasks
+	scheduler();
 	return;
 }
-
-
@@ -26,4 +26,6 @@
 void pit_init();
 void pit_handler();
 
+extern uint32_t pit_ticks;
+
 #endif /* _PIT_H */
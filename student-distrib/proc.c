@@ -0,0 +1,181 @@
+/* proc.c
+ * Pseudo files that show kernel counters as text. syscall_open falls back to
+ * them when a name isn't in the file system, the fd's inode is the entry index.
+ */
+
+#include "proc.h"
+#include "exe_cache.h"
+#include "latency.h"
+#include "bcache.h"
+#include "fs_module.h"
+#include "lib.h"
+
+static uint32_t exestat_show(char* buf, uint32_t size);
+static uint32_t fsstat_show(char* buf, uint32_t size);
+
+proc_entry_t proc_entries[] = {
+	{ "exestat", exestat_show },
+	{ "irqstat", irqstat_show },
+	{ "sysstat", sysstat_show },
+	{ "fsstat", fsstat_show },
+};
+
+#define PROC_COUNT (sizeof(proc_entries) / sizeof(proc_entries[0]))
+
+// Contents are rendered here on every read
+char proc_buf[PROC_BUF_SIZE];
+
+fops_table_t proc_fops = {
+	.open = proc_open,
+	.close = proc_close,
+	.read = proc_read,
+	.write = proc_write
+};
+
+/* proc_lookup()
+ * Input: file name
+ * Return: index of the pseudo file, -1 if there is none with that name
+ * Effect: none
+ */
+int32_t proc_lookup(const char* name) {
+	uint32_t i;
+
+	for(i = 0; i < PROC_COUNT; i++) {
+		if(strncmp(proc_entries[i].name, name, strlen(proc_entries[i].name) + 1) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* proc_puts()
+ * Input: output buffer, length written so far, buffer size, string
+ * Return: new length
+ * Effect: appends the string, strings that don't fit are dropped
+ */
+uint32_t proc_puts(char* buf, uint32_t len, uint32_t size, const char* str) {
+	uint32_t str_len = strlen(str);
+
+	if(len + str_len > size)
+		return len;
+	memcpy(buf + len, str, str_len);
+	return len + str_len;
+}
+
+/* proc_print()
+ * Input: output buffer, length written so far, buffer size, label, value
+ * Return: new length
+ * Effect: appends a "label value" line
+ */
+uint32_t proc_print(char* buf, uint32_t len, uint32_t size, const char* label, uint32_t value) {
+	return proc_print_row(buf, len, size, label, &value, 1);
+}
+
+/* proc_print_row()
+ * Input: output buffer, length written so far, buffer size, label, values and their count
+ * Return: new length
+ * Effect: appends a line of the label and the values split by spaces, lines that
+ *			don't fit are dropped whole
+ */
+uint32_t proc_print_row(char* buf, uint32_t len, uint32_t size, const char* label, const uint32_t* values, uint32_t count) {
+	char num[12];		// a space, 10 digits of a uint32_t and the terminator
+	uint32_t i, next;
+	uint32_t start = len;
+
+	len = proc_puts(buf, len, size, label);
+	if(len == start)
+		return start;
+	num[0] = ' ';
+	for(i = 0; i < count; i++) {
+		itoa(values[i], num + 1, 10);
+		next = proc_puts(buf, len, size, num);
+		if(next == len)
+			return start;
+		len = next;
+	}
+	if(len + 1 > size)
+		return start;
+	buf[len++] = '\n';
+	return len;
+}
+
+/* exestat_show()
+ * Input: output buffer and its size
+ * Return: length of the text
+ * Effect: shows how often execute found the program in the image cache
+ */
+static uint32_t exestat_show(char* buf, uint32_t size) {
+	uint32_t len = 0;
+
+	len = proc_print(buf, len, size, "hits", exe_cache_hits);
+	len = proc_print(buf, len, size, "misses", exe_cache_misses);
+	return len;
+}
+
+/* fsstat_show()
+ * Input: output buffer and its size
+ * Return: length of the text
+ * Effect: shows the block cache counters and the free space on the disk
+ */
+static uint32_t fsstat_show(char* buf, uint32_t size) {
+	uint32_t len = 0;
+
+	len = proc_print(buf, len, size, "hits", bcache_hits);
+	len = proc_print(buf, len, size, "misses", bcache_misses);
+	len = proc_print(buf, len, size, "writebacks", bcache_writebacks);
+	len = proc_print(buf, len, size, "dirty", bcache_dirty_count());
+	len = proc_print(buf, len, size, "free_blocks", fs_free_blocks());
+	return len;
+}
+
+/* proc_open()
+ * Input: ptr to the entry index, file name
+ * Return: 0 if the index is a pseudo file, -1 otherwise
+ * Effect: none
+ */
+int32_t proc_open(int32_t* inode, char* filename) {
+	if((*inode < 0) || (*inode >= PROC_COUNT))
+		return -1;
+	return 0;
+}
+
+/* proc_close()
+ * Input: ptr to the entry index
+ * Return: 0
+ * Effect: none
+ */
+int32_t proc_close(int32_t* inode) {
+	return 0;
+}
+
+/* proc_read()
+ * Input: ptr to the entry index, ptr to the file position, buffer and its length
+ * Return: bytes read, 0 at the end of the file
+ * Effect: renders the file and copies from the current position, so reading in
+ *			pieces can mix counters from different moments
+ */
+int32_t proc_read(int32_t* inode, uint32_t* offset, char* buf, uint32_t len) {
+	uint32_t size, flags;
+
+	cli_and_save(flags);
+	size = proc_entries[*inode].show(proc_buf, PROC_BUF_SIZE);
+	if(*offset >= size) {
+		restore_flags(flags);
+		return 0;
+	}
+	if(len > size - *offset)
+		len = size - *offset;
+	memcpy(buf, proc_buf + *offset, len);
+	restore_flags(flags);
+
+	*offset += len;
+	return len;
+}
+
+/* proc_write()
+ * Input: ptr to the entry index, ptr to the file position, buffer and its length
+ * Return: -1, pseudo files are read only
+ * Effect: none
+ */
+int32_t proc_write(int32_t* inode, uint32_t* offset, char* buf, uint32_t len) {
+	return -1;
+}
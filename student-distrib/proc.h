@@ -0,0 +1,34 @@
+/* proc.h
+ */
+
+#ifndef _PROC_H
+#define _PROC_H
+
+#include "types.h"
+#include "system_call.h"
+
+// Largest text a pseudo file can produce
+#define PROC_BUF_SIZE 4096
+
+// Writes the file's current contents into buf, returns the length
+typedef uint32_t (*proc_show_t)(char* buf, uint32_t size);
+
+// Kernel counters readable through open/read, they don't exist in the boot module
+typedef struct proc_entry_t {
+	const char* name;
+	proc_show_t show;
+} proc_entry_t;
+
+int32_t proc_lookup(const char* name);
+uint32_t proc_puts(char* buf, uint32_t len, uint32_t size, const char* str);
+uint32_t proc_print(char* buf, uint32_t len, uint32_t size, const char* label, uint32_t value);
+uint32_t proc_print_row(char* buf, uint32_t len, uint32_t size, const char* label, const uint32_t* values, uint32_t count);
+
+int32_t proc_open(int32_t* inode, char* filename);
+int32_t proc_close(int32_t* inode);
+int32_t proc_read(int32_t* inode, uint32_t* offset, char* buf, uint32_t len);
+int32_t proc_write(int32_t* inode, uint32_t* offset, char* buf, uint32_t len);
+
+extern fops_table_t proc_fops;
+
+#endif /* _PROC_H */
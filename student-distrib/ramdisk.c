@@ -0,0 +1,84 @@
+/* ramdisk.c
+ * Block device the file system lives on. At boot the file system image from the
+ * boot module is copied into RAMDISK_BLOCKS contiguous frames, the blocks past
+ * the image are where new file data goes. Data blocks are only read and written
+ * through the buffer cache in bcache.c.
+ */
+
+#include "ramdisk.h"
+#include "frame.h"
+#include "lib.h"
+
+// First byte of block 0 and the size of the disk in blocks
+uint32_t ramdisk_base = 0;
+uint32_t ramdisk_size = 0;
+
+/* ramdisk_init()
+ * Input: address of the file system image, its size in blocks
+ * Return: 0 if the image was copied to a full size disk, -1 if there was no room
+ *			and the image is used in place with no free blocks
+ * Effect: sets up the disk, runs before paging so the copy uses physical addresses
+ */
+int32_t ramdisk_init(uint32_t image, uint32_t image_blocks) {
+	uint32_t disk;
+
+	if(image_blocks < RAMDISK_BLOCKS)
+		disk = frames_alloc(RAMDISK_BLOCKS);
+	else
+		disk = 0;
+	if(disk == 0) {
+		ramdisk_base = image;
+		ramdisk_size = image_blocks;
+		return -1;
+	}
+
+	memcpy((void*)disk, (void*)image, image_blocks * FS_BLOCK_SIZE);
+	memset((void*)(disk + image_blocks * FS_BLOCK_SIZE), 0, (RAMDISK_BLOCKS - image_blocks) * FS_BLOCK_SIZE);
+	ramdisk_base = disk;
+	ramdisk_size = RAMDISK_BLOCKS;
+	return 0;
+}
+
+/* ramdisk_blocks()
+ * Input: none
+ * Return: size of the disk in blocks
+ * Effect: none
+ */
+uint32_t ramdisk_blocks(void) {
+	return ramdisk_size;
+}
+
+/* ramdisk_block_addr()
+ * Input: block number
+ * Return: address of the block in memory, 0 if it is past the end of the disk
+ * Effect: none, the contents can be stale while the block is dirty in the buffer cache
+ */
+uint32_t ramdisk_block_addr(uint32_t block) {
+	if(block >= ramdisk_size)
+		return 0;
+	return ramdisk_base + block * FS_BLOCK_SIZE;
+}
+
+/* ramdisk_read()
+ * Input: block number, 4kb buffer
+ * Return: 0 on success, -1 if the block is past the end of the disk
+ * Effect: copies the block into buf
+ */
+int32_t ramdisk_read(uint32_t block, void* buf) {
+	if(block >= ramdisk_size)
+		return -1;
+	memcpy(buf, (void*)(ramdisk_base + block * FS_BLOCK_SIZE), FS_BLOCK_SIZE);
+	return 0;
+}
+
+/* ramdisk_write()
+ * Input: block number, 4kb buffer
+ * Return: 0 on success, -1 if the block is past the end of the disk
+ * Effect: copies buf onto the block
+ */
+int32_t ramdisk_write(uint32_t block, const void* buf) {
+	if(block >= ramdisk_size)
+		return -1;
+	memcpy((void*)(ramdisk_base + block * FS_BLOCK_SIZE), buf, FS_BLOCK_SIZE);
+	return 0;
+}
@@ -0,0 +1,19 @@
+/* ramdisk.h
+ */
+
+#ifndef _RAMDISK_H
+#define _RAMDISK_H
+
+#include "types.h"
+
+#define FS_BLOCK_SIZE 4096
+// 4MB disk, the boot module is copied to the front and the rest is free data blocks
+#define RAMDISK_BLOCKS 1024
+
+int32_t ramdisk_init(uint32_t image, uint32_t image_blocks);
+uint32_t ramdisk_blocks(void);
+uint32_t ramdisk_block_addr(uint32_t block);
+int32_t ramdisk_read(uint32_t block, void* buf);
+int32_t ramdisk_write(uint32_t block, const void* buf);
+
+#endif /* _RAMDISK_H */
@@ -5,17 +5,23 @@
 #include "i8259.h"
 #include "lib.h"
 #include "system_call.h"
+#include "wait_queue.h"
+#include "vdso.h"
 
-// Virtualized frequency of RTC, RTC running at 1024 Hz
-uint32_t virt_freq;
-// Count of interrupts, used to see if reached virt_freq's period
-uint32_t rtc_inter_count; 
+// Hardware interrupts since boot, the clock all virtual rtcs count against
+uint32_t rtc_ticks;
+// Per fd virtual rtcs
+rtc_timer_t rtc_timers[RTC_MAX_TIMERS];
+// Timer wheel, slot (deadline % RTC_WHEEL_SIZE) lists the readers expiring on that tick
+rtc_timer_t* rtc_wheel[RTC_WHEEL_SIZE];
 
 fops_table_t rtc_fops = {
 	.open = rtc_open,
 	.close = rtc_close,
 	.read = rtc_read,
-	.write = rtc_write
+	.write = rtc_write,
+	.dup = rtc_dup,
+	.poll = rtc_poll
 };
 
 /* rtc_init() (heffley)
@@ -39,11 +45,8 @@ void rtc_init(void) {
 	// Set frequency to max (1024) Hz
 	rtc_set_frequency(1024);
 	
-	// Set virtualized frequency to be 2 Hz by default
-	virt_freq = 2;
-	
-	// Set rtc_int_count to 0, as no interrupts have happened
-	rtc_inter_count = 0;
+	// Set rtc_ticks to 0, as no interrupts have happened
+	rtc_ticks = 0;
 	
 	// Enable rtc irq
 	enable_irq(RTC_IRQ_NUM);
@@ -55,12 +58,30 @@ void rtc_init(void) {
 /* rtc_handler() (heffley)
  * Inputs: none
  * Returns: none
- * Effects: Called when rtc generates interrupts, sets up for next interrupt
+ * Effects: Called when rtc generates interrupts, wakes the readers expiring on this tick
+ *			and sets up for next interrupt
  */
 void rtc_handler(void) {
+	rtc_timer_t* timer;
+	rtc_timer_t* next;
+
 	// Increase interrupt count
-	rtc_inter_count++;
+	rtc_ticks++;
+	vdso_rtc_tick(rtc_ticks);
 
+	// Every timer in this slot expires now, since no period is longer than the wheel
+	timer = rtc_wheel[rtc_ticks & (RTC_WHEEL_SIZE - 1)];
+	rtc_wheel[rtc_ticks & (RTC_WHEEL_SIZE - 1)] = NULL;
+	if(timer != NULL)
+		poll_wake();
+	while(timer != NULL) {
+		next = timer->next;
+		timer->next = NULL;
+		timer->prev = NULL;
+		timer->pending = 0;
+		wake_up(&timer->queue);
+		timer = next;
+	}
 
 	// Need to read register C for future interrupts to occur
 	outb(STATUS_REG_C, RTC_PORT);
@@ -72,61 +93,165 @@ void rtc_handler(void) {
 
 
 /* rtc_write() (heffley)
- * Inputs: fd unused, buf ptr containing new frequency, nbytes to check if 4 bytes
+ * Inputs: fd holding the virtual rtc index, buf ptr containing new frequency, nbytes to check if 4 bytes
  * Returns: 0 on success, -1 on failure
- * Effects: Changes the frequency at which the real time clock generates interrupts
+ * Effects: Changes the frequency at which this fd's virtual rtc generates interrupts
  */
 int32_t rtc_write(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes) {
+	uint32_t freq;
+
 	// Check if nbytes = 4, if not, invalid
 	if(nbytes != 4) {
 		return -1;
 	}
+	if((*fd < 0) || (*fd >= RTC_MAX_TIMERS) || !rtc_timers[*fd].in_use) {
+		return -1;
+	}
 	
-	//return rtc_set_frequency(*(uint32_t*)buf);
+	freq = *(uint32_t*)buf;
 	// Check if input is a valid power of 2, otherwise return failure
-	if((*(uint32_t*)buf <= 1024) && (*(uint32_t*)buf >= 2) && !(*(uint32_t*)buf & (*(uint32_t*)buf - 1))) {
-		// Valid power of 2, reset interrupt count and set frequency
-		rtc_inter_count = 0;
-		virt_freq = *(uint32_t*)buf;
+	if((freq <= RTC_HW_FREQ) && (freq >= 2) && !(freq & (freq - 1))) {
+		// Valid power of 2, only this fd's period changes
+		rtc_timers[*fd].period = RTC_HW_FREQ / freq;
 		return 0;
 	}
 	// Invald input, so return failure
 	return -1;
 }
 
+/* rtc_arm()
+ * Inputs: virtual rtc
+ * Returns: 1 if a virtual interrupt has passed since the last read, 0 if not
+ * Effects: Queues the timer in the wheel for the next virtual interrupt after the
+ *			last read, unless it already is. Interrupts must be off.
+ */
+static int32_t rtc_arm(rtc_timer_t* timer) {
+	uint32_t slot;
+
+	if(timer->pending)
+		return 0;
+	// Next virtual interrupt is the next multiple of the period, queue it in that slot
+	timer->deadline = (timer->last / timer->period + 1) * timer->period;
+	if(timer->deadline <= rtc_ticks)
+		return 1;
+	slot = timer->deadline & (RTC_WHEEL_SIZE - 1);
+	timer->prev = NULL;
+	timer->next = rtc_wheel[slot];
+	if(timer->next != NULL)
+		timer->next->prev = timer;
+	rtc_wheel[slot] = timer;
+	timer->pending = 1;
+	return 0;
+}
+
 /* rtc_read() (heffley)
- * Inputs: fd, buf ptr, nbytes, all unused
- * Returns: 0 on completed interrupt
- * Effects: returns when interrupt is completed
+ * Inputs: fd holding the virtual rtc index, buf ptr, nbytes unused
+ * Returns: 0 on completed interrupt, -1 on bad fd
+ * Effects: Sleeps until the next virtual interrupt of this fd's frequency after
+ *			the last read, returning at once if it has already passed
  */
 int32_t rtc_read(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes) {
-	
-	// Set interrupt count to 0
-	rtc_inter_count = 0;
+	rtc_timer_t* timer;
 
-	// Spin until 1024/frequency interrupts have occured
-	while(rtc_inter_count < (1024 / virt_freq)) {}
+	if((*fd < 0) || (*fd >= RTC_MAX_TIMERS) || !rtc_timers[*fd].in_use) {
+		return -1;
+	}
+	timer = &rtc_timers[*fd];
+	
+	cli();
+	// Sleep until the handler pulls the timer out of the wheel
+	if(!rtc_arm(timer)) {
+		while(timer->pending) {
+			sleep_on(&timer->queue);
+		}
+	}
+	timer->last = rtc_ticks;
+	sti();
 	
 	return 0;
 }
 
+/* rtc_poll()
+ * Inputs: fd holding the virtual rtc index, unused
+ * Returns: POLLIN once a read would not sleep, 0 if it would, POLLNVAL on bad fd
+ * Effects: queues the timer so its expiry wakes pollers. Interrupts must be off
+ */
+int32_t rtc_poll(int32_t* fd, uint32_t* i) {
+	if((*fd < 0) || (*fd >= RTC_MAX_TIMERS) || !rtc_timers[*fd].in_use) {
+		return POLLNVAL;
+	}
+	return rtc_arm(&rtc_timers[*fd]) ? POLLIN : 0;
+}
+
 
 /* rtc_open() (heffley)
- * Inputs: filename ptr, unused
- * Returns: 0 on success (always)
- * Effects: Sets the frequency to 2 Hz
+ * Inputs: i ptr to store the virtual rtc index in, filename ptr, unused
+ * Returns: 0 on success, -1 if every virtual rtc is in use
+ * Effects: Gives the fd its own virtual rtc, set to 2 Hz
  */
 int32_t rtc_open(int32_t* i, char* filename) {
-	virt_freq = 2; 
+	int32_t index;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	for(index = 0; index < RTC_MAX_TIMERS; index++) {
+		if(!rtc_timers[index].in_use) {
+			rtc_timers[index].in_use = 1;
+			rtc_timers[index].period = RTC_HW_FREQ / RTC_DEFAULT_FREQ;
+			rtc_timers[index].pending = 0;
+			rtc_timers[index].last = rtc_ticks;
+			rtc_timers[index].next = NULL;
+			rtc_timers[index].prev = NULL;
+			wait_queue_init(&rtc_timers[index].queue);
+			*i = index;
+			restore_flags(flags);
+			return 0;
+		}
+	}
+	restore_flags(flags);
+	return -1;
+}
+
+/* rtc_dup()
+ * Inputs: virtual rtc index to copy, ptr to store the new index in
+ * Returns: 0 on success, -1 on bad index or if every virtual rtc is in use
+ * Effects: Gives a forked or dup2'd fd its own virtual rtc running at the same rate
+ */
+int32_t rtc_dup(int32_t old_i, int32_t* new_i) {
+	if((old_i < 0) || (old_i >= RTC_MAX_TIMERS) || !rtc_timers[old_i].in_use)
+		return -1;
+	if(rtc_open(new_i, NULL) == -1)
+		return -1;
+	rtc_timers[*new_i].period = rtc_timers[old_i].period;
 	return 0;
 }
 
 /* rtc_close() (heffley)
- * Inputs: fd, unused
- * Returns: 0 on success (always)
- * Effects: 
+ * Inputs: fd holding the virtual rtc index
+ * Returns: 0 on success, -1 on bad fd
+ * Effects: Takes the virtual rtc out of the wheel and frees it
  */
 int32_t rtc_close(int32_t* fd) {
+	rtc_timer_t* timer;
+	uint32_t flags;
+
+	if((*fd < 0) || (*fd >= RTC_MAX_TIMERS) || !rtc_timers[*fd].in_use) {
+		return -1;
+	}
+	timer = &rtc_timers[*fd];
+
+	cli_and_save(flags);
+	if(timer->pending) {
+		if(timer->prev != NULL)
+			timer->prev->next = timer->next;
+		else
+			rtc_wheel[timer->deadline & (RTC_WHEEL_SIZE - 1)] = timer->next;
+		if(timer->next != NULL)
+			timer->next->prev = timer->prev;
+		timer->pending = 0;
+	}
+	timer->in_use = 0;
+	restore_flags(flags);
 	return 0;
 }
 
@@ -6,6 +6,7 @@
 
 #include "types.h"
 #include "system_call.h"
+#include "wait_queue.h"
 
 
 // IO ports, see wiki.osdev.org/RTC
@@ -34,14 +35,38 @@
 #define RTC_512_HZ 0x07
 #define RTC_1024_HZ 0x06
 
+// Hardware runs at 1024 Hz, every open rtc gets its own virtual frequency on top of it
+#define RTC_HW_FREQ 1024
+#define RTC_DEFAULT_FREQ 2
+// One wheel slot per tick, must be a power of 2 and longer than the slowest period (512 ticks)
+#define RTC_WHEEL_SIZE 1024
+// Every fd of every task could be an rtc
+#define RTC_MAX_TIMERS (MAX_TASKS * 8)
+
+// Per open file virtual rtc, the index of the timer is kept in the fd's inode field
+typedef struct rtc_timer_t {
+	uint32_t in_use;
+	uint32_t period;					//hardware ticks between virtual interrupts
+	uint32_t deadline;					//tick the pending read expires on
+	uint32_t last;						//tick the last read returned on, the next one waits for the period after it
+	uint32_t pending;					//1 while queued in the timer wheel
+	wait_queue_t queue;					//task sleeping in rtc_read on this timer
+	struct rtc_timer_t* next;			//other timers in the same wheel slot
+	struct rtc_timer_t* prev;
+} rtc_timer_t;
+
 extern void rtc_init(void);
 extern void rtc_handler(void);
 int32_t rtc_write(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes);
 int32_t rtc_read(int32_t* fd, uint32_t* i, char* buf, uint32_t nbytes);
 int32_t rtc_open(int32_t* i, char* filename);
 int32_t rtc_close(int32_t* fd);
+int32_t rtc_dup(int32_t old_i, int32_t* new_i);
+int32_t rtc_poll(int32_t* fd, uint32_t* i);
 uint32_t rtc_set_frequency(uint32_t new_frequency);
 
 extern fops_table_t rtc_fops;
+extern uint32_t rtc_ticks;
+extern rtc_timer_t rtc_timers[RTC_MAX_TIMERS];
 
 #endif /* _RTC_H */
@@ -1,73 +1,146 @@
 #include "scheduler.h"
 #include "i8259.h"
+#include "latency.h"
 
+// Number of terminals that already have their base shell running
+uint32_t shells_started = 0;
+// Set once all base shells are up so the display can go back to terminal 1
 uint32_t bootup_flag = 0;
-int active_process;
+// 1 while the cpu is halted because no task is runnable
+uint32_t idle_flag = 0;
 
 /* scheduler()
- * Input: the terminal ID that will be "scheduled"
+ * Input: none
  * Return: none
- * Effect: Originally meant to switch execution between programs, but wasn't functional
- *			currently only spawns in the 3 different shells when they do not exist
+ * Effect: Round robin preemptive scheduler, called from the pit handler with interrupts off.
+ *			Does nothing while the cpu is halted in the idle loop, since the idle loop is
+ *			already in the middle of picking a task on this stack.
  */
-void scheduler(uint32_t t_num){
-	
-	//check for invalid terminal number
-	if(t_num >= TERMINAL_COUNT || t_num < 0)
+void scheduler(void){
+	if(idle_flag)
 		return;
-	
+	schedule();
+}
+
+/* schedule()
+ * Input: none
+ * Return: none
+ * Effect: Spawns the 3 base shells on the first calls, afterwards saves the kernel stack of the
+ *			current task and switches to the next runnable task, loading its user page and esp0.
+ *			If no task can run, halts until an interrupt makes one runnable. Called with
+ *			interrupts off, either from the pit or from a task going to sleep.
+ */
+void schedule(void){
+	int32_t curr_task = get_tasks_running();
+	int32_t next_task;
+	pcb_t* curr_pcb;
+	pcb_t* next_pcb;
+
 	//After the first 3 shells have been made, switch back to terminal 1
 	if(bootup_flag) {
-		t_num = 0;
-		switch_display_terminal(t_num);
+		switch_display_terminal(0);
 		bootup_flag = 0;
 	}
-	
-	//reference to the current active process of given terminal
-	//active_process = switch_running_task(t_num);
-	active_process = find_bottom_task(t_num);
-	
-	//invalid task, run shell
-	if(active_process == -1) {
-		send_eoi(0);
-		if(t_num == 2)
+
+	//Spawn the base shells one per call, the interrupted task resumes later from here
+	if(shells_started < TERMINAL_COUNT) {
+		if(curr_task != -1) {
+			curr_pcb = get_pcb(curr_task);
+			asm volatile(
+			"movl %%esp, %0 \n"
+			"movl %%ebp, %1 \n"
+			:"=m" (curr_pcb->sched_esp), "=m" (curr_pcb->sched_ebp)
+			:
+			:"memory"
+			);
+		}
+		shells_started++;
+		if(shells_started == TERMINAL_COUNT)
 			bootup_flag = 1;
-		switch_display_terminal(t_num);
-		syscall_execute((const uint8_t*)"shell");
+		switch_display_terminal(shells_started - 1);
+		execute_terminal_shell(shells_started - 1);
+		return;
+	}
+
+	next_task = find_next_task(curr_task);
+
+	//nothing can run, halt until an interrupt handler wakes a task up
+	while(next_task == -1) {
+		idle_flag = 1;
+		asm volatile(
+		"sti \n"
+		"hlt \n"
+		"cli \n"
+		:
+		:
+		:"memory"
+		);
+		idle_flag = 0;
+		next_task = find_next_task(curr_task);
 	}
-	
-	//get pcb of active task of this terminal
-	/*pcb_t* active_pcb = get_pcb(active_process);
-	
-	//Save esp and ebp from current process
-	asm volatile("movl %%esp, %0":"=r" (active_pcb->old_esp));
-    asm volatile("movl %%ebp, %0":"=r" (active_pcb->old_ebp));
-	
+
+	//only the current task can run, keep running it
+	if(next_task == curr_task)
+		return;
+
+	curr_pcb = get_pcb(curr_task);
+	next_pcb = get_pcb(next_task);
+
 	//remap paging to new process
-	syscall_paging_setup(eightM + (fourM * active_process));
-	
+	syscall_paging_setup(next_pcb->user_table);
+	if(next_pcb->vidmap_flag)
+		videomem_map(_148MB, terminal_video_addr(next_pcb->terminal_id));
+	else if(curr_pcb->vidmap_flag)
+		videomem_unmap(_148MB, video_mem_addr);
+	if(next_pcb->mmap_fd != -1)
+		file_pages_load(next_pcb->file_table);
+	else if(curr_pcb->mmap_fd != -1)
+		file_pages_unload();
+
 	//save kernel stack, esp pointer
 	tss.ss0 = KERNEL_DS;
-	tss.esp0 = eightM - (eightK * active_process) - 4;
-
-	
-	//restore
-	asm volatile ("       	  \n\
-            movl %0, %%esp    \n\
-            movl %1, %%ebp    \n\
-            "
-            :
-            : "r" (active_pcb->old_esp), "r" (active_pcb->old_ebp)
-            : "memory"
-        );*/
-		
+	tss.esp0 = kernel_stack_top(next_task);
+
+	set_tasks_running(next_task);
+	context_switches++;
+
+	//Save esp and ebp of current task, then restore the next task's, returning on its stack
+	asm volatile(
+	"movl %%esp, %0 \n"
+	"movl %%ebp, %1 \n"
+	"movl %2, %%esp \n"
+	"movl %3, %%ebp \n"
+	:"=m" (curr_pcb->sched_esp), "=m" (curr_pcb->sched_ebp)
+	:"r" (next_pcb->sched_esp), "r" (next_pcb->sched_ebp)
+	:"memory"
+	);
+}
+
+/* find_next_task()
+ * Input: task that is currently running
+ * Return: next runnable task after curr_task in round robin order, -1 if none
+ * Effect: none
+ */
+int32_t find_next_task(int32_t curr_task) {
+	int32_t i, task;
+
+	for(i = 1; i <= MAX_TASKS; i++) {
+		task = (curr_task + i) % MAX_TASKS;
+		if(task_slots[task] && (get_pcb(task)->state == TASK_RUNNABLE))
+			return task;
+	}
+	return -1;
 }
 
 /* get_active_terminal()
  * Input: none
  * Return: returns the terminal currently being processed by the scheduler
- * Effect: returns the terminal currently being processed by the scheduler
+ * Effect: returns the terminal of the task that is currently running
  */
 int get_active_terminal() {
-	return active_process;
+	int32_t curr_task = get_tasks_running();
+
+	if(curr_task == -1)
+		return 0;
+	return get_pcb(curr_task)->terminal_id;
 }
@@ -6,5 +6,7 @@
 #include "rtc.h"
 #include "keyboard.h"
 
-extern void scheduler(uint32_t t_num);
+extern void scheduler(void);
+extern void schedule(void);
+extern int32_t find_next_task(int32_t curr_task);
 extern int get_active_terminal();
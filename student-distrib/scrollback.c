@@ -0,0 +1,87 @@
+/* scrollback.c
+ * Lines that scroll off the top of a terminal. Both the line index and the cells
+ * are rings; a new line drops the oldest ones when either runs out, so adding a
+ * line costs the same however much history there is.
+ */
+
+#include "scrollback.h"
+#include "frame.h"
+#include "lib.h"
+
+/* scrollback_init()
+ * Input: history to set up
+ * Return: none
+ * Effect: takes frames for the history, it stays empty and unused if there are none
+ */
+void scrollback_init(scrollback_t* sb) {
+	uint32_t mem = frames_alloc(SCROLLBACK_FRAMES);
+
+	memset(sb, 0, sizeof(scrollback_t));
+	if(mem == 0)
+		return;
+	sb->lines = (sb_line_t*) mem;
+	sb->cells = (uint16_t*) (mem + SCROLLBACK_LINES * sizeof(sb_line_t));
+}
+
+/* scrollback_push()
+ * Input: history, row leaving the screen, its width, the cell a blank position holds
+ * Return: none
+ * Effect: Saves the row without its blank tail. Callers keep interrupts off.
+ *			A screen scrolled back stays on the same lines.
+ */
+void scrollback_push(scrollback_t* sb, uint16_t* row, uint32_t cols, uint16_t blank) {
+	uint32_t len = cols, at, part;
+	sb_line_t* line;
+
+	if(sb->lines == NULL)
+		return;
+
+	while(len > 0 && (row[len - 1] == blank || row[len - 1] == 0))
+		len--;
+
+	// Drop the oldest lines until the index and the cells both have room
+	if(sb->count == SCROLLBACK_LINES) {
+		sb->first++;
+		sb->count--;
+	}
+	while(sb->count > 0 && sb->next_cell + len - sb->lines[sb->first & (SCROLLBACK_LINES - 1)].start > SCROLLBACK_CELLS) {
+		sb->first++;
+		sb->count--;
+	}
+
+	// The cells may wrap around the end of the ring
+	at = sb->next_cell & (SCROLLBACK_CELLS - 1);
+	part = SCROLLBACK_CELLS - at;
+	if(part > len)
+		part = len;
+	memcpy(sb->cells + at, row, part * 2);
+	memcpy(sb->cells, row + part, (len - part) * 2);
+
+	line = &sb->lines[(sb->first + sb->count) & (SCROLLBACK_LINES - 1)];
+	line->start = sb->next_cell;
+	line->len = len;
+	sb->next_cell += len;
+	sb->count++;
+
+	if(sb->view != 0)
+		sb->view++;
+	if(sb->view > sb->count)
+		sb->view = sb->count;
+}
+
+/* scrollback_line()
+ * Input: history, line number counting from the oldest kept, row to fill, its width,
+ *			the cell a blank position holds
+ * Return: none
+ * Effect: expands a saved line back to a full row
+ */
+void scrollback_line(scrollback_t* sb, uint32_t line, uint16_t* row, uint32_t cols, uint16_t blank) {
+	sb_line_t* entry = &sb->lines[(sb->first + line) & (SCROLLBACK_LINES - 1)];
+	uint32_t i, len = entry->len;
+
+	if(len > cols)
+		len = cols;
+	for(i = 0; i < len; i++)
+		row[i] = sb->cells[(entry->start + i) & (SCROLLBACK_CELLS - 1)];
+	memset_word(row + len, blank, cols - len);
+}
@@ -0,0 +1,33 @@
+/* scrollback.h
+ */
+
+#ifndef _SCROLLBACK_H
+#define _SCROLLBACK_H
+
+#include "types.h"
+
+#define SCROLLBACK_LINES 4096			//power of 2, lines remembered per terminal
+#define SCROLLBACK_CELLS 65536			//power of 2, char + attribute cells shared by those lines
+// Frames holding one terminal's line index and cells
+#define SCROLLBACK_FRAMES ((SCROLLBACK_LINES * 8 + SCROLLBACK_CELLS * 2) / 4096)
+
+// One line that scrolled off the top, its blank tail is not stored
+typedef struct sb_line_t {
+	uint32_t start;					//cell counter value where the line begins
+	uint32_t len;					//cells stored, the rest of the row is blank
+} sb_line_t;
+
+typedef struct scrollback_t {
+	sb_line_t* lines;				//ring of SCROLLBACK_LINES, NULL if no memory was free
+	uint16_t* cells;				//ring of SCROLLBACK_CELLS
+	uint32_t first;					//index of the oldest line kept, counts up forever
+	uint32_t count;					//lines kept
+	uint32_t next_cell;				//where the next line's cells go, counts up forever
+	uint32_t view;					//lines the screen is scrolled back by, 0 shows the live screen
+} scrollback_t;
+
+void scrollback_init(scrollback_t* sb);
+void scrollback_push(scrollback_t* sb, uint16_t* row, uint32_t cols, uint16_t blank);
+void scrollback_line(scrollback_t* sb, uint32_t line, uint16_t* row, uint32_t cols, uint16_t blank);
+
+#endif /* _SCROLLBACK_H */
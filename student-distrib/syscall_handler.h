@@ -5,6 +5,8 @@
 
 #ifndef ASM
     extern void syscall_handler_asm();
+    extern void sysenter_handler_asm();
+    extern void task_start_asm();
 #endif
 
 #endif
@@ -7,17 +7,162 @@
 #include "rtc.h"
 #include "keyboard.h"
 #include "paging.h"
+#include "frame.h"
+#include "scheduler.h"
+#include "syscall_handler.h"
+#include "exe_cache.h"
+#include "proc.h"
+#include "latency.h"
+#include "bcache.h"
 #include "lib.h"
+#include "pit.h"
+#include "pipe.h"
 
 // Keep track of currently running task
 int32_t tasks_running = -1;
 
 // Array that tracks if task is running in the slot
-uint32_t task_slots[6] = {0,0,0,0,0,0};
+uint32_t task_slots[MAX_TASKS] = {0};
+
+// PCB and kernel stack of every task, allocated from the frame pool by execute
+pcb_t* pcb_table[MAX_TASKS] = {NULL};
+
+// Terminal that the next execute should start a base shell in, -1 for a normal child
+int32_t shell_terminal = -1;
 
 // 1 if program died by exception, 0 if didn't
 uint32_t exception_death = 0;
 
+// Tasks sleeping in syscall_poll, and how many of them have a timeout
+static wait_queue_t poll_queue = {-1};
+static uint32_t poll_timed = 0;
+
+/* fd_dup()
+ * Input: fd to copy, fd slot to copy it into
+ * Returns: 0 on success, -1 if the file can't be shared, the slot is left closed then
+ * Effect: Opens the same file in another slot. Files with a dup function get their
+ *			own reference, so each copy is closed on its own. Positions aren't shared.
+ */
+static int32_t fd_dup(file_descriptor_t* from, file_descriptor_t* to) {
+	*to = *from;
+	if(from->flags && (from->fops_table->dup != NULL) && ((*from->fops_table->dup)(from->inode, &to->inode) == -1)) {
+		to->flags = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/* fd_close()
+ * Input: pcb of the running task, open fd to close, 0 and 1 included
+ * Returns: -1 if the file's close fails, 0 otherwise
+ * Effect: Closes the file and frees the slot
+ */
+static int32_t fd_close(pcb_t* pcb, int32_t fd) {
+	file_descriptor_t* file = &pcb->fd[fd];
+
+	if((file->fops_table->close != NULL) && ((*file->fops_table->close)(&file->inode) == -1))
+		return -1;
+
+	//drop the file mapping if this fd backs it
+	if(pcb->mmap_fd == fd) {
+		pcb->mmap_fd = -1;
+		file_pages_clear(pcb->file_table);
+		file_pages_unload();
+	}
+
+	file->file_position = 0;
+	file->flags = 0;
+	return 0;
+}
+
+/* vidmap_unpin()
+ * Input: terminal whose vidmap program just went away
+ * Returns: none
+ * Effect: Lets the terminal's VGA window scroll by start address again, unless
+ *			another task on it still draws there through vidmap
+ */
+static void vidmap_unpin(uint32_t tid) {
+	uint32_t i;
+	pcb_t* pcb;
+
+	for(i = 0; i < MAX_TASKS; i++) {
+		pcb = pcb_table[i];
+		if((pcb != NULL) && (pcb->state != TASK_ZOMBIE) && pcb->vidmap_flag && (pcb->terminal_id == tid))
+			return;
+	}
+	screen_pin(tid, 0);
+}
+
+/* task_reap()
+ * Input: task id of a halted task that isn't running
+ * Returns: none
+ * Effect: Gives the task's page tables, pcb and kernel stack back to the frame pool
+ *			and frees its slot. Its program frames were freed when it halted.
+ */
+static void task_reap(uint32_t task_id) {
+	pcb_t* pcb = pcb_table[task_id];
+
+	frame_free((uint32_t)pcb->user_table);
+	if(pcb->file_table != NULL)
+		frame_free((uint32_t)pcb->file_table);
+	pcb_table[task_id] = NULL;
+	task_slots[task_id] = 0;
+	frames_free((uint32_t)pcb, eightK / fourK);
+}
+
+/* orphan_children()
+ * Input: task id that is halting
+ * Returns: none
+ * Effect: Forked and spawned children of the task lose their parent. Ones that already
+ *			halted are reaped now, the rest are reaped by find_open_task() once they halt.
+ */
+static void orphan_children(uint32_t task_id) {
+	uint32_t i;
+	pcb_t* pcb;
+
+	for(i = 0; i < MAX_TASKS; i++) {
+		pcb = pcb_table[i];
+		if((pcb == NULL) || !pcb->async || (pcb->task_id_parent != task_id))
+			continue;
+		pcb->task_id_parent = -1;
+		if(pcb->state == TASK_ZOMBIE)
+			task_reap(i);
+	}
+}
+
+/* task_exit()
+ * Input: pcb of the running task, exit status
+ * Returns: never
+ * Effect: Halt for tasks made by fork or spawn. Frees the program's memory, wakes the
+ *			parent if it's in syscall_wait and switches away for good. The pcb and
+ *			kernel stack stay until the task is reaped. Interrupts must be off.
+ */
+static void task_exit(pcb_t* pcb, uint32_t status) {
+	uint32_t i;
+
+	for(i = 0; i < 8; i++) {
+		if(pcb->fd[i].flags) {
+			fd_close(pcb, i);
+		}
+	}
+	if(pcb->vidmap_flag) {
+		videomem_unmap(_148MB, video_mem_addr);
+		pcb->vidmap_flag = 0;
+		vidmap_unpin(pcb->terminal_id);
+	}
+	user_pages_free(pcb->user_table);
+	flush_TLB();
+
+	orphan_children(pcb->task_id);
+	pcb->exit_status = status;
+	pcb->state = TASK_ZOMBIE;
+	if(pcb->task_id_parent != -1)
+		wake_up(&pcb_table[pcb->task_id_parent]->child_queue);
+
+	// Never picked again, the parent or find_open_task() frees this stack
+	schedule();
+}
+
 /* system_halt()
  * Input: status
  * Returns: 32 bit int expanded from 8 bit argument for execute's return val
@@ -25,11 +170,29 @@ uint32_t exception_death = 0;
  */
 int32_t syscall_halt(uint8_t status) {
 
-	uint32_t i, return_status;
+	uint32_t i, return_status, old_esp, old_ebp;
+
+	// The scheduler must not switch away while the task chain is being torn down
+	cli();
 
 	//************RESTORE PARENT DATA************//
 	pcb_t* process_control_block = get_pcb(tasks_running);
 
+	// If died by exception, return 256, otherwise return status
+	if(exception_death) {
+		return_status = 256;
+		exception_death = 0;
+	}
+	else
+		return_status = (uint32_t)status;
+
+	// A program that took raw or non-blocking input gives the terminal back to line input
+	ldisc_task_exit(process_control_block->terminal_id, process_control_block->task_id);
+
+	// Forked and spawned tasks have no execute to return to
+	if(process_control_block->async)
+		task_exit(process_control_block, return_status);
+
 	// Make sure it isnt the final shell
 	if(process_control_block->task_id_parent == -1) {
 		// Don't want final shell to exit, so rerun shell program
@@ -38,7 +201,7 @@ int32_t syscall_halt(uint8_t status) {
 		printf("Halting final shell is not allowed\n");
 
 		tss.ss0 = KERNEL_DS; // Kernel's stack segment
-		tss.esp0 = (eightK * oneK - (eightK * (tasks_running)) - 4); //process' kernel-mode stack
+		tss.esp0 = kernel_stack_top(tasks_running); //process' kernel-mode stack
 
 		// Grab the EIP from pcb
 		uint32_t EIP_bytes;
@@ -54,6 +217,7 @@ int32_t syscall_halt(uint8_t status) {
 		"pushl %%eax \n"
 		"pushl $0x83FFFFC \n"
 		"pushf \n"
+		"orl $0x200, (%%esp) \n"
 		"pushl $0x23 \n"
 		"pushl %0 \n"
 		"iret \n"
@@ -65,42 +229,58 @@ int32_t syscall_halt(uint8_t status) {
 
 	pcb_t* parent_control_block = get_pcb(process_control_block->task_id_parent);
 	parent_control_block->task_id_child = -1;
+	parent_control_block->state = TASK_RUNNABLE;
 
 	//************RESTORE PARENT PAGING************//
 
-	syscall_paging_setup(eightM + (process_control_block->task_id_parent) * fourM);
-	uint32_t k = _148MB / fourM;
-	uint32_t j = page_directory[k] & 0x01; // check whether the page is allocated
-	if ( j ){
+	syscall_paging_setup(parent_control_block->user_table);
+	if(parent_control_block->vidmap_flag) {
+		videomem_map(_148MB, terminal_video_addr(parent_control_block->terminal_id));
+	} else if(process_control_block->vidmap_flag) {
 		videomem_unmap(_148MB, video_mem_addr);
+		//back at a program that doesn't draw, the window can scroll by start address again
+		process_control_block->vidmap_flag = 0;
+		vidmap_unpin(process_control_block->terminal_id);
 	}
+	process_control_block->vidmap_flag = 0;
 
 	//************CLOSE RELEVANT FDS************//
 
-	// Check if fd 2-7 are in use, close if they are
+	// Close every fd in use, stdin and stdout may be pipes that need letting go
 	for(i = 0; i < 8; i++) {
 		if(process_control_block->fd[i].flags) {
-			syscall_close(i);
+			fd_close(process_control_block, i);
 		}
 	}
 
+	// Closing the fds dropped this task's file mapping, bring back the parent's
+	if(parent_control_block->mmap_fd != -1)
+		file_pages_load(parent_control_block->file_table);
+
+	//************FREE TASK MEMORY************//
+
+	// Still running on this task's kernel stack, but interrupts are off so
+	// nothing can allocate the frames before the stack switch below
+	old_esp = process_control_block->old_esp;
+	old_ebp = process_control_block->old_ebp;
+	orphan_children(tasks_running);
+	user_pages_free(process_control_block->user_table);
+	frame_free((uint32_t)process_control_block->user_table);
+	if(process_control_block->file_table != NULL)
+		frame_free((uint32_t)process_control_block->file_table);
+	pcb_table[tasks_running] = NULL;
+	frames_free((uint32_t)process_control_block, eightK / fourK);
+
 	//Clear the allocated task slot
 	task_slots[tasks_running] = 0;
 
 	//Change tasks_running to the parent's id
 	tasks_running = process_control_block->task_id_parent;
+	context_switches++;
 
 	//************JUMP TO EXECUTE'S RETURN************//
 
-	tss.esp0 = process_control_block->old_esp;
-
-	// If died by exception, return 256, otherwise return status
-	if(exception_death) {
-		return_status = 256;
-		exception_death = 0;
-	}
-	else
-		return_status = (uint32_t)status;
+	tss.esp0 = kernel_stack_top(tasks_running);
 
 	// Store status in eax, change stack ptrs to previous prgm
 	asm volatile(
@@ -108,7 +288,7 @@ int32_t syscall_halt(uint8_t status) {
 		"movl %1, %%esp \n"
 		"movl %2, %%ebp \n"
 		:
-		:"r"(return_status), "r"(process_control_block->old_esp), "r"(process_control_block->old_ebp)
+		:"r"(return_status), "r"(old_esp), "r"(old_ebp)
 		:"eax"
 	);
 
@@ -125,23 +305,15 @@ int32_t syscall_halt(uint8_t status) {
 
 
 
-/* system_execute()
- * Input: command pointer for what to be executed
- * Returns: -1 if cannot be execute, 256 if program dies by exception, 0-255 otherwise if halt happens
- * Effect: Attempts to load and execute a new program, hands off processor until new program terminates
+/* parse_command()
+ * Input: command to parse, buffers for the task name and its argument
+ * Returns: -1 if the name is too long, 0 if the command is blank, 1 otherwise
+ * Effect: Splits a command into the program name and the argument string, spaces
+ *			and tabs after the argument are dropped
  */
-int32_t syscall_execute(const uint8_t* command) {
-
-	// Local variables
-	uint8_t task_name[TASKNAME_SIZE]; // max size of fname max size + 1 for null char
-	uint8_t argument[ARGUMENT_SIZE]; // max size of keyboard buffer max size + 1 for null char
+int32_t parse_command(const uint8_t* command, uint8_t* task_name, uint8_t* argument) {
 	uint32_t i, j;		  // loop counts
-	char buf[4];		  // char buf for file_read() to check if elf, need 4 bytes to check
-	dentry_t file_check;
-	uint32_t EIP_bytes = 0;
-	uint32_t pcb_esp, pcb_ebp;
 	uint32_t blank_cmd_flag = 0;
-	uint32_t new_slot, old_slot;
 
 	//************PARSE ARGS************//
 	i = 0;
@@ -180,68 +352,219 @@ int32_t syscall_execute(const uint8_t* command) {
 		i++;
 	}
 
+	// Drop trailing blanks, "cat file | grep x" hands cat "file " otherwise
+	while((j > 0) && ((argument[j - 1] == SPACE_CHAR) || (argument[j - 1] == '\t')))
+		j--;
+
 	// Add null to end of argument
 	argument[j] = NULL_CHAR;
-		
 
 	//Check if task_name is blank
 	for(i = 0; i < strlen((const char*)task_name); i++) {
 		if((task_name[i] != ' ') || (task_name[i] == '\n'))
 			blank_cmd_flag = 1;
 	}
-	//If task_name was blank, don't display anything in shell
-	if(blank_cmd_flag == 0)
-		return 0;
+	return blank_cmd_flag;
+}
 
-	//************CHECK FILE VALIDITY************//
+/* program_lookup()
+ * Input: program name, image for the cache to fill in when it has no room
+ * Returns: the program's image, pinned until exe_cache_put(), NULL if it isn't a valid executable
+ * Effect: Finds the file, the image cache checks it is an ELF and reads the EIP
+ *			from bytes 24-27 the first time the program runs. Reads the file on a
+ *			miss, so call it with interrupts on.
+ */
+static exe_image_t* program_lookup(const uint8_t* task_name, exe_image_t* spare) {
+	dentry_t file_check;
 
 	// Check if task_name is a valid file, return invalid if not
-	read_dentry_by_name((const char*)task_name, &file_check);
-	if(read_data(file_check.inode, 0, buf, 4) != 4) {
-		return -1;
+	if(read_dentry_by_name((const char*)task_name, &file_check) == -1) {
+		return NULL;
 	}
+	return exe_cache_lookup(file_check.inode, spare);
+}
 
-	// Check buf to make sure file is elf, return invalid if not
-	if((buf[0] != ELF_CHECK0) || (buf[1] != ELF_CHECK1) || (buf[2] != ELF_CHECK2) || (buf[3] != ELF_CHECK3)) {
-		return -1;
-	}
+/* task_alloc()
+ * Input: none
+ * Returns: the new task's pcb, NULL if no slot or memory is left
+ * Effect: Claims a task slot and allocates its pcb, kernel stack and program page
+ *			table from the frame pool. Must be called with interrupts off.
+ */
+static pcb_t* task_alloc(void) {
+	int32_t new_slot;
+	uint32_t pcb_frames, table_frame;
+	pcb_t* pcb;
 
-	// Make sure there aren't 6 tasks running already, else, go next task
+	// Make sure there aren't MAX_TASKS tasks running already
 	new_slot = find_open_task();
 	if(new_slot == -1) {
 		printf("Max programs reached, only valid command: exit\n");
-		return -1;
-	} else {
-		old_slot = tasks_running;
-		tasks_running = new_slot;
-		task_slots[tasks_running] = 1;
+		return NULL;
 	}
 
-	//************SET UP PAGING************//
-	syscall_paging_setup(eightM + (tasks_running) * fourM);
+	// Grab the pcb with its kernel stack and the program's page table
+	pcb_frames = frames_alloc(eightK / fourK);
+	table_frame = frame_alloc();
+	if((pcb_frames == 0) || (table_frame == 0)) {
+		if(pcb_frames != 0)
+			frames_free(pcb_frames, eightK / fourK);
+		if(table_frame != 0)
+			frame_free(table_frame);
+		printf("Out of memory\n");
+		return NULL;
+	}
+	task_slots[new_slot] = 1;
+	pcb = (pcb_t*)pcb_frames;
+	pcb_table[new_slot] = pcb;
+
+	pcb->task_id = new_slot;
+	pcb->task_id_child = -1;
+	pcb->user_table = (uint32_t*)table_frame;
+	pcb->file_table = NULL;
+	pcb->state = TASK_RUNNABLE;
+	pcb->vidmap_flag = 0;
+	pcb->wait_next = -1;
+	pcb->mmap_fd = -1;
+	pcb->async = 0;
+	pcb->exit_status = 0;
+	wait_queue_init(&pcb->child_queue);
+	return pcb;
+}
+
+/* task_load()
+ * Input: new task's pcb, cached program image, task name and argument,
+ *			task whose stdin and stdout it inherits (NULL for the terminal's)
+ * Returns: none
+ * Effect: Sets the task up to run the program. The image's frames are shared copy
+ *			on write, anything else is read in by demand_page() on first touch,
+ *			so nothing is copied here
+ */
+static void task_load(pcb_t* process_control_block, exe_image_t* image, uint8_t* task_name, uint8_t* argument, pcb_t* parent) {
+	uint32_t i;
+
+	if(image->pages != NULL)
+		user_pages_share(image->pages, process_control_block->user_table);
+	else
+		user_pages_init(process_control_block->user_table);
 
-	//************LOAD FILE INTO MEMORY************//
-	read_data(file_check.inode, 0, (char*)program_addr, twoM);
+	process_control_block->exe_inode = image->inode;
+	process_control_block->exe_length = image->length;
+	process_control_block->old_eip = image->eip;
 
-	// Grab bytes 24-27 for the EIP
-	EIP_bytes = *((uint32_t*)program_addr + eip_offset);
+	//fill in file name and argument buf
+	for(i = 0; i < (TASKNAME_SIZE); i++) {
+		process_control_block->file_name[i] = task_name[i];
+		process_control_block->argument_buf[i] = argument[i];
+	}
+	for(; i < (ARGUMENT_SIZE); i++) {
+		process_control_block->argument_buf[i] = argument[i];
+	}
 
-	//************CREATE PCB/OPEN FDs************//
+	// init fd
+	fda_init(process_control_block, parent);
+}
 
-	// Assign the pcb to a portion in kernel space
+/* task_start_frame()
+ * Input: new task's pcb, user eip and esp to start at
+ * Returns: ptr to the user register frame on the new task's kernel stack
+ * Effect: Builds the stack the scheduler switches to the first time it picks a task
+ *			made by fork or spawn. schedule() returns into task_start_asm, which leaves
+ *			through the end of the syscall handler with the frame below.
+ */
+static uint32_t* task_start_frame(pcb_t* pcb, uint32_t eip, uint32_t esp) {
+	uint32_t* frame = (uint32_t*)(kernel_stack_top(pcb->task_id) - SYSCALL_FRAME_SIZE);
+
+	/* Kernel stack of a new task, same layout syscall_handler_asm leaves on the stack
+	 * [	SS		]
+	 * [	ESP		]
+	 * [	EFLAGS	]
+	 * [	CS		]
+	 * [	EIP		]
+	 * [ EBP ESI EDI ]
+	 * [ latency sample, skipped ]
+	 * [ EDX ECX EBX ] <- frame
+	 * [ task_start_asm ]		return address for schedule()
+	 * [	0		] <- sched_ebp, saved ebp for schedule()
+	 */
+	memset(frame, 0, SYSCALL_FRAME_SIZE);
+	frame[13] = 0x2B;
+	frame[12] = esp;
+	frame[11] = 0x202;		// IF on
+	frame[10] = 0x23;
+	frame[9] = eip;
+	frame[-1] = (uint32_t)task_start_asm;
+	frame[-2] = 0;
+	frame[-3] = 0;
+	pcb->sched_ebp = (uint32_t)&frame[-2];
+	pcb->sched_esp = (uint32_t)&frame[-3];
+	return frame;
+}
 
-	pcb_t* process_control_block = get_pcb(tasks_running);
-	// Fill in pcb task values
-	process_control_block->task_id = tasks_running;
+/* system_execute()
+ * Input: command pointer for what to be executed
+ * Returns: -1 if cannot be execute, 256 if program dies by exception, 0-255 otherwise if halt happens
+ * Effect: Attempts to load and execute a new program, hands off processor until new program terminates
+ */
+int32_t syscall_execute(const uint8_t* command) {
+
+	// Local variables
+	uint8_t task_name[TASKNAME_SIZE]; // max size of fname max size + 1 for null char
+	uint8_t argument[ARGUMENT_SIZE]; // max size of keyboard buf size + 1 for null char
+	uint32_t EIP_bytes = 0;
+	exe_image_t* image;
+	exe_image_t spare;
+	uint32_t pcb_esp, pcb_ebp;
+	int32_t parse;
+	uint32_t old_slot;
+	uint32_t flags;
+	pcb_t* process_control_block;
+
+	parse = parse_command(command, task_name, argument);
+	if(parse == -1)
+		return -1;
+	//If task_name was blank, don't display anything in shell
+	if(parse == 0)
+		return 0;
+
+	//************CHECK FILE VALIDITY************//
+
+	// A cold program is read in with interrupts on, the pin keeps it cached until it is shared
+	image = program_lookup(task_name, &spare);
+	if(image == NULL)
+		return -1;
+	EIP_bytes = image->eip;
+
+	// From here until the iret the task list is inconsistent, so keep the scheduler out
+	cli_and_save(flags);
+
+	process_control_block = task_alloc();
+	if(process_control_block == NULL) {
+		exe_cache_put(image);
+		restore_flags(flags);
+		return -1;
+	}
+	old_slot = tasks_running;
+	tasks_running = process_control_block->task_id;
+
+	//************LOAD FILE INTO MEMORY/CREATE PCB/OPEN FDs************//
+	task_load(process_control_block, image, task_name, argument, (shell_terminal == -1) ? get_pcb(old_slot) : NULL);
+	exe_cache_put(image);
+
+	//************SET UP PAGING************//
+	syscall_paging_setup(process_control_block->user_table);
 
 	// If not one of three base shells, fill in parent info
-	if(tasks_running >= 3) { 
+	if(shell_terminal == -1) {
 		process_control_block->task_id_parent = old_slot;
-		// Also tell parent block that it has a child
+		// Also tell parent block that it has a child, parent sleeps until the child halts
 		pcb_t* parent_control_block = get_pcb(old_slot);
 		parent_control_block->task_id_child = tasks_running;
+		parent_control_block->state = TASK_WAITING;
+		process_control_block->terminal_id = parent_control_block->terminal_id;
 	} else {
 		process_control_block->task_id_parent = -1;
+		process_control_block->terminal_id = shell_terminal;
+		shell_terminal = -1;
 	}
 
 	// Get current esp and ebp for pcb
@@ -251,27 +574,14 @@ int32_t syscall_execute(const uint8_t* command) {
 	:"=r" (pcb_esp), "=r" (pcb_ebp)
 	:
 	);
-	process_control_block->task_id_child = -1;
 	process_control_block->old_esp = pcb_esp;
 	process_control_block->old_ebp = pcb_ebp;
-	process_control_block->old_eip = EIP_bytes;
-
-	//fill in file name and argument buf
-	for(i = 0; i < (TASKNAME_SIZE); i++) {
-		process_control_block->file_name[i] = task_name[i];
-		process_control_block->argument_buf[i] = argument[i];
-	}
-	for(; i < (ARGUMENT_SIZE); i++) {
-		process_control_block->argument_buf[i] = argument[i];
-	}
-
-	// init fd
-	fda_init();
 
 	//************PREPARE FOR CONTEXT SWITCH************//
 
 	tss.ss0 = KERNEL_DS; // Kernel's stack segment
-	tss.esp0 = (eightK * oneK - (eightK * (tasks_running)) - 4); //process' kernel-mode stack
+	tss.esp0 = kernel_stack_top(tasks_running); //process' kernel-mode stack
+	context_switches++;
 
 
 
@@ -280,7 +590,7 @@ int32_t syscall_execute(const uint8_t* command) {
 	/* Interrupted Procedure's Stack	Handler's Stack
 	 * [        ] <-ESP	before			[	SS		] (User DS = 0x2B)
 	 * [        ]						[	ESP		] (bottom of page holding executable, 132 MB - 4 = 0x8400000 - 4 = 0x83FFFFC)
-	 * [        ]						[	EFLAGS	]
+	 * [        ]						[	EFLAGS	] (IF forced on, execute runs with interrupts off)
 	 * [        ]		=>				[	CS		] (User CS = 0x23)
 	 * [        ]						[	EIP		] (bytes 24-27 of executable)
 	 * [        ]						[Error code	] <-ESP after
@@ -296,6 +606,7 @@ int32_t syscall_execute(const uint8_t* command) {
 		"pushl %%eax \n"
 		"pushl $0x83FFFFC \n"
 		"pushf \n"
+		"orl $0x200, (%%esp) \n"
 		"pushl $0x23 \n"
 		"pushl %0 \n"
 		"iret \n"
@@ -317,8 +628,8 @@ int32_t syscall_execute(const uint8_t* command) {
  */
 int32_t syscall_read (uint32_t fd, void* buf, int32_t nbytes){
 
-	//check for invalid input
-	if((fd > 7) || (fd == 1))
+	//check for invalid input, fd 1 has no read unless dup2 put something else there
+	if(fd > 7)
 		return -1;
 
 	pcb_t* pcb = get_pcb(tasks_running);
@@ -353,8 +664,8 @@ int32_t syscall_read (uint32_t fd, void* buf, int32_t nbytes){
  * Effect: file is written with contents from buf
  */
 int32_t syscall_write(uint32_t fd, void* buf, int32_t nbytes){
-	//check for invalid input
-	if((fd > 7) || (fd < 1))
+	//check for invalid input, fd 0 has no write unless dup2 put something else there
+	if(fd > 7)
 		return -1;
 
 	pcb_t* pcb = get_pcb(tasks_running);
@@ -434,7 +745,12 @@ int32_t syscall_open(const uint8_t* filename) {
 			fd_array[fd_index].fops_table = &dir_fops;
 		else if(dentry.type == 2)	//file
 			fd_array[fd_index].fops_table = &file_fops;
+
+		//hand the resolved inode to open so it doesn't look the name up again
+		fd_array[fd_index].inode = dentry.inode;
 	}
+	else if((fd_array[fd_index].inode = proc_lookup((char*) filename)) != -1)
+		fd_array[fd_index].fops_table = &proc_fops;	//kernel counters
 	else
 		return -1;	//return error if file is non-existent
 
@@ -451,12 +767,13 @@ int32_t syscall_open(const uint8_t* filename) {
 /* system_close() - added by mlee148
  * Input: file name to be opened
  * Returns: -1 if cannot be execute
- * Effect:
+ * Effect: fds 0 and 1 can only be closed while dup2 has put something other than
+ *			the terminal there, so a pipeline stage can end its output early
  */
 int32_t syscall_close(int32_t fd) {
 
 	//check for invalid input
-	if((fd > 7) || (fd < 2))
+	if((fd > 7) || (fd < 0))
 		return -1;
 
 
@@ -469,6 +786,10 @@ int32_t syscall_close(int32_t fd) {
 	if(fd_array[fd].flags == 0)
 		return -1;
 
+	//the terminal's stdin and stdout stay open
+	if((fd < 2) && ((fd_array[fd].fops_table == &stdin_fops) || (fd_array[fd].fops_table == &stdout_fops)))
+		return -1;
+
 	//error out if fd table is invalid
 	if(fd_array == NULL)
 		return -1;
@@ -477,16 +798,8 @@ int32_t syscall_close(int32_t fd) {
 	if(fd_array[fd].fops_table->close == NULL)
 		return -1;
 
-	//if the called close function returns -1, return -1
-	if((*fd_array[fd].fops_table->close)(&fd_array[fd].inode) == -1)
-		return -1;
-
-	//reset entry's file_position
-	fd_array[fd].file_position = 0;
-
-	//free the fda entry and return 0
-	fd_array[fd].flags = 0;
-	return 0;
+	//if the called close function returns -1, return -1, otherwise free the fda entry
+	return fd_close(pcb, fd);
 }
 
 /* syscall_getargs() - added by mlee148
@@ -530,31 +843,713 @@ int32_t syscall_getargs(uint8_t* buf, int32_t nbytes) {
 int syscall_vidmap(uint8_t ** screen_start){
 	if ( screen_start == NULL || screen_start == (uint8_t **)fourM)
 		return -1;
-	//148MB is the user video page location 
-	videomem_map(_148MB, video_mem_addr);
+	//148MB is the user video page location, backed by the task's terminal's VGA window
+	screen_pin(get_active_terminal(), 1);
+	videomem_map(_148MB, terminal_video_addr(get_active_terminal()));
+	if(tasks_running != -1)
+		get_pcb(tasks_running)->vidmap_flag = 1;
 	*screen_start = (uint8_t*) _148MB ;
 
 	 return 0;
 
 }
+/* syscall_ioctl
+ * Input: fd, request, its argument
+ * Returns: what the file returns for the request, -1 if it takes none
+ * Effect: Device control. The terminal on fd 0 takes IOCTL_TERM_MODE.
+ */
+int32_t syscall_ioctl(uint32_t fd, int32_t request, int32_t arg){
+	file_descriptor_t* file;
+
+	if(fd > 7)
+		return -1;
+	file = &get_pcb(tasks_running)->fd[fd];
+	if((file->flags == 0) || (file->fops_table->ioctl == NULL))
+		return -1;
+	return (*file->fops_table->ioctl)(&file->inode, request, arg);
+}
+/* poll_scan()
+ * Input: calling task, its copy of the poll array, entries in it
+ * Returns: how many entries have something in revents
+ * Effect: asks each fd what is ready, interrupts must be off
+ */
+static int32_t poll_scan(pcb_t* pcb, pollfd_t* fds, int32_t nfds){
+	file_descriptor_t* file;
+	int32_t i, ready = 0;
+
+	for(i = 0; i < nfds; i++) {
+		file = &pcb->fd[fds[i].fd & 7];
+		if((fds[i].fd < 0) || (fds[i].fd > 7) || (file->flags == 0) || (file->fops_table->poll == NULL))
+			fds[i].revents = POLLNVAL;
+		else
+			fds[i].revents = (*file->fops_table->poll)(&file->inode, &file->file_position) & (fds[i].events | POLLNVAL);
+		if(fds[i].revents != 0)
+			ready++;
+	}
+	return ready;
+}
+
+/* syscall_poll
+ * Input: user array of fds and the events wanted on each, its length, PIT ticks
+ *			to wait at most (-1 waits for ever, 0 only looks)
+ * Returns: entries with revents set, 0 on timeout, -1 on a bad array
+ * Effect: Sleeps until one of the fds is ready. Event sources call poll_wake
+ *			and every poller looks again, a timed poller also wakes each tick.
+ */
+int32_t syscall_poll(pollfd_t* fds, int32_t nfds, int32_t timeout){
+	pollfd_t copy[POLL_MAX];
+	pcb_t* pcb = get_pcb(tasks_running);
+	uint32_t flags, deadline = pit_ticks + timeout;
+	int32_t ready;
+
+	if((nfds < 0) || (nfds > POLL_MAX) || (timeout < -1) || (nfds == 0 && timeout == -1))
+		return -1;
+	// The array itself has to sit in the program page
+	if(((uint32_t)fds < virtual_mem) || ((uint32_t)(fds + nfds) > virtual_mem + fourM))
+		return -1;
+	memcpy(copy, fds, nfds * sizeof(pollfd_t));
+
+	cli_and_save(flags);
+	while(1) {
+		ready = poll_scan(pcb, copy, nfds);
+		if((ready > 0) || (timeout == 0) || ((timeout > 0) && ((int32_t)(pit_ticks - deadline) >= 0)))
+			break;
+		if(timeout > 0)
+			poll_timed++;
+		sleep_on(&poll_queue);
+		if(timeout > 0)
+			poll_timed--;
+	}
+	restore_flags(flags);
+
+	memcpy(fds, copy, nfds * sizeof(pollfd_t));
+	return ready;
+}
+
+/* poll_wake
+ * Input: none
+ * Returns: none
+ * Effect: something may have become ready, every sleeping poller looks again
+ */
+void poll_wake(void){
+	wake_up(&poll_queue);
+}
+
+/* poll_tick
+ * Input: none
+ * Returns: none
+ * Effect: called on every PIT tick, wakes the pollers when one of them has a timeout
+ */
+void poll_tick(void){
+	if(poll_timed != 0)
+		wake_up(&poll_queue);
+}
+/* syscall_pipe
+ * Input: user array of two fds
+ * Returns: 0 on success, -1 on a bad array or if no pipe or fd pair is free
+ * Effect: Makes a pipe, fds[0] reads what is written into fds[1]. Reads sleep
+ *			while it is empty and return 0 once every write end is closed, writes
+ *			sleep while it is full and fail once every read end is closed.
+ */
+int32_t syscall_pipe(int32_t* fds){
+	pcb_t* pcb = get_pcb(tasks_running);
+	int32_t rd, wr, p;
+
+	if(((uint32_t)fds < virtual_mem) || ((uint32_t)(fds + 2) > virtual_mem + fourM))
+		return -1;
+	for(rd = 2; (rd < 8) && pcb->fd[rd].flags; rd++);
+	for(wr = rd + 1; (wr < 8) && pcb->fd[wr].flags; wr++);
+	if(wr >= 8)
+		return -1;
+	p = pipe_alloc();
+	if(p == -1)
+		return -1;
+
+	pcb->fd[rd].fops_table = &pipe_read_fops;
+	pcb->fd[rd].inode = p;
+	pcb->fd[rd].file_position = 0;
+	pcb->fd[rd].flags = 1;
+	pcb->fd[wr].fops_table = &pipe_write_fops;
+	pcb->fd[wr].inode = p;
+	pcb->fd[wr].file_position = 0;
+	pcb->fd[wr].flags = 1;
+	fds[0] = rd;
+	fds[1] = wr;
+	return 0;
+}
+
+/* syscall_dup2
+ * Input: open fd, fd to make a copy of it (-1 for the lowest free one from 2)
+ * Returns: the new fd, -1 on a bad fd or if no fd is free
+ * Effect: Closes newfd if it was open and opens oldfd's file there. fds 0 and 1
+ *			can be replaced too, programs started with execute or spawn get the
+ *			caller's fds 0 and 1, which is how a shell hands them a pipe.
+ */
+int32_t syscall_dup2(int32_t oldfd, int32_t newfd){
+	pcb_t* pcb = get_pcb(tasks_running);
+	uint32_t flags;
+
+	if((oldfd < 0) || (oldfd > 7) || (newfd < -1) || (newfd > 7) || (pcb->fd[oldfd].flags == 0))
+		return -1;
+	if(newfd == -1) {
+		for(newfd = 2; (newfd < 8) && pcb->fd[newfd].flags; newfd++);
+		if(newfd >= 8)
+			return -1;
+	}
+	if(newfd == oldfd)
+		return newfd;
+
+	cli_and_save(flags);
+	if(pcb->fd[newfd].flags && (fd_close(pcb, newfd) == -1)) {
+		restore_flags(flags);
+		return -1;
+	}
+	if(fd_dup(&pcb->fd[oldfd], &pcb->fd[newfd]) == -1) {
+		restore_flags(flags);
+		return -1;
+	}
+	restore_flags(flags);
+	return newfd;
+}
+
+/* syscall_set_handler
+ * Input: signal number, handler address
+ * Returns: -1, signals are not supported
+ * Effect: none
+ */
+int32_t syscall_set_handler(int32_t signum, void* handler_address){
+	return -1;
+}
+
+/* syscall_sigreturn
+ * Input: none
+ * Returns: -1, signals are not supported
+ * Effect: none
+ */
+int32_t syscall_sigreturn(void){
+	return -1;
+}
+
+/* syscall_mmap
+ * Input: fd of an open regular file, user ptr to a ptr to be assigned the mapping
+ * Returns: length of the file, -1 if cannot be mapped
+ * Effect: maps the file's data blocks read only at 152MB, straight from the boot module.
+ *			Each 4kb block gets its own page, so the blocks appear contiguous even when they
+ *			are scattered in the module. Replaces the task's previous mapping,
+ *			which is gone even if this one fails.
+ */
+int32_t syscall_mmap(int32_t fd, uint8_t** start){
+	uint32_t i, length, block, flags;
+
+	//check for invalid input, the pointer must be in the task's own page
+	if((fd > 7) || (fd < 2))
+		return -1;
+	if(((uint32_t)start < virtual_mem) || ((uint32_t)start > virtual_mem + fourM - 4))
+		return -1;
+
+	pcb_t* pcb = get_pcb(tasks_running);
+	file_descriptor_t* fd_array = pcb->fd;
+
+	//only regular files live in the boot module
+	if((fd_array[fd].flags == 0) || (fd_array[fd].fops_table != &file_fops))
+		return -1;
+
+	//the mapping's page table is only allocated the first time it's needed
+	if(pcb->file_table == NULL) {
+		pcb->file_table = (uint32_t*)frame_alloc();
+		if(pcb->file_table == NULL)
+			return -1;
+	}
+
+	//the mapping reads the ram disk directly, so get recent writes out of the block cache
+	bcache_sync();
+
+	//rebuild the task's mapping from the file's block list, fs_truncate sees it all or nothing
+	cli_and_save(flags);
+	length = inode_length(fd_array[fd].inode);
+	file_pages_clear(pcb->file_table);
+	for(i = 0; i * fourK < length; i++) {
+		block = data_block_addr(fd_array[fd].inode, i);
+		if(block == 0) {
+			//the old mapping is already gone, drop it for good and flush its TLB entries
+			pcb->mmap_fd = -1;
+			file_pages_clear(pcb->file_table);
+			file_pages_unload();
+			restore_flags(flags);
+			return -1;
+		}
+		file_page_map(pcb->file_table, i, block);
+	}
+	pcb->mmap_fd = fd;
+	file_pages_load(pcb->file_table);
+	restore_flags(flags);
+
+	*start = (uint8_t*) _152MB;
+	return length;
+}
+
+/* file_mapped
+ * Input: inode of a regular file
+ * Returns: 1 if some task has the file mapped with syscall_mmap, 0 otherwise
+ * Effect: none, call with interrupts off so no mapping appears meanwhile
+ */
+int32_t file_mapped(uint32_t inode){
+	uint32_t i;
+	pcb_t* pcb;
+
+	for(i = 0; i < MAX_TASKS; i++) {
+		pcb = pcb_table[i];
+		if((pcb != NULL) && (pcb->mmap_fd != -1) && (pcb->fd[pcb->mmap_fd].inode == inode))
+			return 1;
+	}
+	return 0;
+}
+
+/* syscall_fork
+ * Input: none
+ * Returns: child's task id to the parent, 0 to the child, -1 if no task can be made
+ * Effect: Copies the running task. The program page is shared copy on write, so nothing
+ *			is copied until one side writes. The child gets its own copy of the fds and
+ *			runs alongside the parent, which collects it with syscall_wait. Task 0 is
+ *			always the first base shell, so 0 is never a child's id.
+ */
+int32_t syscall_fork(void){
+	uint32_t i, flags;
+	pcb_t* parent;
+	pcb_t* child;
+	uint32_t* frame;
+
+	cli_and_save(flags);
+	parent = get_pcb(tasks_running);
+	child = task_alloc();
+	if(child == NULL) {
+		restore_flags(flags);
+		return -1;
+	}
+
+	child->task_id_parent = tasks_running;
+	child->terminal_id = parent->terminal_id;
+	child->vidmap_flag = parent->vidmap_flag;
+	child->async = 1;
+	child->exe_inode = parent->exe_inode;
+	child->exe_length = parent->exe_length;
+	child->old_eip = parent->old_eip;
+	for(i = 0; i < TASKNAME_SIZE; i++)
+		child->file_name[i] = parent->file_name[i];
+	for(i = 0; i < ARGUMENT_SIZE; i++)
+		child->argument_buf[i] = parent->argument_buf[i];
+
+	//every fd is copied, rtcs get their own virtual rtc so both sides can sleep on one
+	for(i = 0; i < 8; i++)
+		fd_dup(&parent->fd[i], &child->fd[i]);
+
+	user_pages_share(parent->user_table, child->user_table);
+
+	//the child resumes from the same int 0x80 as the parent, returning 0
+	frame = task_start_frame(child, 0, 0);
+	memcpy(frame, (void*)(kernel_stack_top(tasks_running) - SYSCALL_FRAME_SIZE), SYSCALL_FRAME_SIZE);
+
+	restore_flags(flags);
+	return child->task_id;
+}
+
+/* syscall_spawn
+ * Input: command pointer for what to be executed
+ * Returns: new task's id, -1 if cannot be executed
+ * Effect: Starts a program like execute, but the caller keeps running. The new task
+ *			shares the caller's terminal and is collected with syscall_wait.
+ */
+int32_t syscall_spawn(const uint8_t* command){
+	uint8_t task_name[TASKNAME_SIZE];
+	uint8_t argument[ARGUMENT_SIZE];
+	uint32_t flags;
+	exe_image_t* image;
+	exe_image_t spare;
+	pcb_t* child;
+
+	if(parse_command(command, task_name, argument) != 1)
+		return -1;
+	image = program_lookup(task_name, &spare);
+	if(image == NULL)
+		return -1;
+	cli_and_save(flags);
+	child = task_alloc();
+	if(child == NULL) {
+		exe_cache_put(image);
+		restore_flags(flags);
+		return -1;
+	}
+	task_load(child, image, task_name, argument, get_pcb(tasks_running));
+	exe_cache_put(image);
+	child->task_id_parent = tasks_running;
+	child->terminal_id = get_pcb(tasks_running)->terminal_id;
+	child->async = 1;
+
+	//nothing of the program is touched until it runs, so the caller's paging stays loaded
+	task_start_frame(child, child->old_eip, 0x83FFFFC);
+
+	restore_flags(flags);
+	return child->task_id;
+}
+
+/* syscall_wait
+ * Input: child task id or -1 for any child, user ptr for the exit status or NULL, options
+ * Returns: id of the reaped child, 0 with WAIT_NOHANG if no child halted yet,
+ *			-1 if there is no such child
+ * Effect: Sleeps until a forked or spawned child halts, then frees what is left of it
+ */
+int32_t syscall_wait(int32_t pid, int32_t* status, int32_t options){
+	uint32_t i, flags, found;
+	int32_t exit_status;
+	pcb_t* pcb;
+	pcb_t* child;
+
+	if((status != NULL) && (((uint32_t)status < virtual_mem) || ((uint32_t)status > virtual_mem + fourM - 4)))
+		return -1;
+
+	pcb = get_pcb(tasks_running);
+	cli_and_save(flags);
+	while(1) {
+		found = 0;
+		for(i = 0; i < MAX_TASKS; i++) {
+			child = pcb_table[i];
+			if((child == NULL) || !child->async || (child->task_id_parent != tasks_running))
+				continue;
+			if((pid != -1) && (pid != i))
+				continue;
+			found = 1;
+			if(child->state == TASK_ZOMBIE) {
+				exit_status = child->exit_status;
+				task_reap(i);
+				restore_flags(flags);
+				if(status != NULL)
+					*status = exit_status;
+				return i;
+			}
+		}
+		if(!found) {
+			restore_flags(flags);
+			return -1;
+		}
+		if(options & WAIT_NOHANG) {
+			restore_flags(flags);
+			return 0;
+		}
+		sleep_on(&pcb->child_queue);
+	}
+}
+
+/* syscall_create
+ * Input: file name in the program page, CREATE_TRUNC and CREATE_APPEND flags
+ * Returns: fd of the file, -1 if it cannot be created or opened or the name is
+ *			outside the program page or longer than MAX_FILENAME
+ * Effect: Opens a regular file, making it first if it doesn't exist. CREATE_TRUNC
+ *			empties it unless a task has it mapped, CREATE_APPEND starts the fd's
+ *			position at the end.
+ */
+int32_t syscall_create(const uint8_t* filename, int32_t flags){
+	uint8_t name[MAX_FILENAME + 1];
+	dentry_t dentry;
+	int32_t fd, i;
+
+	if((filename == NULL) || (flags & ~(CREATE_TRUNC | CREATE_APPEND)))
+		return -1;
+	//the name has to sit in the program page, copy it so the fs never walks user memory
+	if(((uint32_t)filename < virtual_mem) || ((uint32_t)filename >= virtual_mem + fourM))
+		return -1;
+	for(i = 0; (i < MAX_FILENAME + 1) && ((uint32_t)(filename + i) < virtual_mem + fourM); i++) {
+		name[i] = filename[i];
+		if(name[i] == NULL_CHAR)
+			break;
+	}
+	if((i == MAX_FILENAME + 1) || ((uint32_t)(filename + i) >= virtual_mem + fourM))
+		return -1;
+
+	//pseudo files have no inode to write
+	if(proc_lookup((const char*)name) != -1)
+		return -1;
+	if((fs_create((const char*)name, &dentry) == -1) || (dentry.type != 2))
+		return -1;
+	if((flags & CREATE_TRUNC) && (fs_truncate(dentry.inode, 0) == -1))
+		return -1;
+
+	fd = syscall_open(name);
+	if((fd != -1) && (flags & CREATE_APPEND))
+		get_pcb(tasks_running)->fd[fd].file_position = inode_length(dentry.inode);
+	return fd;
+}
+
+/* iov_fetch()
+ * Input: user iovec array and its length, kernel array to copy it into
+ * Return: total bytes the buffers hold, -1 if the array is bad
+ * Effect: The array is copied so the user can't change it while the call runs
+ */
+static int32_t iov_fetch(iovec_t* iov, int32_t iovcnt, iovec_t* copy){
+	int32_t i, total = 0;
+
+	if((iovcnt <= 0) || (iovcnt > IOV_MAX))
+		return -1;
+	// The array itself has to sit in the program page
+	if(((uint32_t)iov < virtual_mem) || ((uint32_t)(iov + iovcnt) > virtual_mem + fourM))
+		return -1;
+
+	memcpy(copy, iov, iovcnt * sizeof(iovec_t));
+	for(i = 0; i < iovcnt; i++) {
+		if((copy[i].len < 0) || ((copy[i].base == NULL) && (copy[i].len != 0)))
+			return -1;
+		if(copy[i].len > 0x7FFFFFFF - total)
+			return -1;
+		total += copy[i].len;
+	}
+	return total;
+}
+
+/* syscall_readv
+ * Input: fd - file descriptor id
+		  iov - buffers to fill in order
+		  iovcnt - number of buffers, at most IOV_MAX
+ * Returns: total bytes read, -1 on failure
+ * Effect: Reads once into several buffers. Files that can't scatter are read one
+ *			buffer at a time, stopping at the first short read.
+ */
+int32_t syscall_readv(uint32_t fd, iovec_t* iov, int32_t iovcnt){
+	iovec_t copy[IOV_MAX];
+	int32_t i, ret, total = 0;
+	file_descriptor_t* file;
+
+	if(fd > 7)
+		return -1;
+	file = &get_pcb(tasks_running)->fd[fd];
+	if((file->flags == 0) || (iov_fetch(iov, iovcnt, copy) == -1))
+		return -1;
+
+	if(file->fops_table->readv != NULL)
+		return (*file->fops_table->readv)(&file->inode, &file->file_position, copy, iovcnt);
+	if(file->fops_table->read == NULL)
+		return -1;
+
+	for(i = 0; i < iovcnt; i++) {
+		ret = (*file->fops_table->read)(&file->inode, &file->file_position, (char*)copy[i].base, copy[i].len);
+		if(ret == -1)
+			return (total > 0) ? total : -1;
+		total += ret;
+		if(ret < copy[i].len)
+			break;
+	}
+	return total;
+}
+
+/* syscall_writev
+ * Input: fd - file descriptor id
+		  iov - buffers to write in order
+		  iovcnt - number of buffers, at most IOV_MAX
+ * Returns: total bytes written, -1 on failure
+ * Effect: Writes several buffers with one call. Files that can't gather are
+ *			written one buffer at a time, stopping at the first short write.
+ */
+int32_t syscall_writev(uint32_t fd, iovec_t* iov, int32_t iovcnt){
+	iovec_t copy[IOV_MAX];
+	int32_t i, ret, total = 0;
+	file_descriptor_t* file;
+
+	if(fd > 7)
+		return -1;
+	file = &get_pcb(tasks_running)->fd[fd];
+	if((file->flags == 0) || (iov_fetch(iov, iovcnt, copy) == -1))
+		return -1;
+
+	if(file->fops_table->writev != NULL)
+		return (*file->fops_table->writev)(&file->inode, &file->file_position, copy, iovcnt);
+	if(file->fops_table->write == NULL)
+		return -1;
+
+	for(i = 0; i < iovcnt; i++) {
+		ret = (*file->fops_table->write)(&file->inode, &file->file_position, (char*)copy[i].base, copy[i].len);
+		if(ret == -1)
+			return (total > 0) ? total : -1;
+		total += ret;
+		if(ret < copy[i].len)
+			break;
+	}
+	return total;
+}
+
+/* syscall_ring_setup
+ * Input: where to store the ring's user address
+ * Returns: 0 on success, -1 on a bad pointer
+ * Effect: Empties the calling task's syscall ring. The ring lives in the unused
+ *			first page of the program page, so it is backed on first touch, copied
+ *			by fork and freed by halt like the rest of the program's memory.
+ */
+int32_t syscall_ring_setup(syscall_ring_t** ring){
+	if(((uint32_t)ring < virtual_mem) || ((uint32_t)(ring + 1) > virtual_mem + fourM))
+		return -1;
+	if(tasks_running == -1)
+		return -1;
+
+	memset((void*)RING_ADDR, 0, sizeof(syscall_ring_t));
+	*ring = (syscall_ring_t*)RING_ADDR;
+	return 0;
+}
+
+/* ring_op()
+ * Input: one submission entry
+ * Return: what the matching syscall returned, -1 for operations the ring doesn't take
+ * Effect: runs the operation as if the task had trapped for it
+ */
+static int32_t ring_op(ring_sqe_t* sqe){
+	switch(sqe->opcode) {
+		case RING_OP_READ:
+			return syscall_read(sqe->arg1, (void*)sqe->arg2, sqe->arg3);
+		case RING_OP_WRITE:
+			return syscall_write(sqe->arg1, (void*)sqe->arg2, sqe->arg3);
+		case RING_OP_OPEN:
+			return syscall_open((const uint8_t*)sqe->arg1);
+		case RING_OP_CLOSE:
+			return syscall_close(sqe->arg1);
+		case RING_OP_READV:
+			return syscall_readv(sqe->arg1, (iovec_t*)sqe->arg2, sqe->arg3);
+		case RING_OP_WRITEV:
+			return syscall_writev(sqe->arg1, (iovec_t*)sqe->arg2, sqe->arg3);
+		default:
+			return -1;
+	}
+}
+
+/* syscall_ring_enter
+ * Input: none
+ * Returns: number of submissions completed, -1 if the ring indices are corrupt
+ * Effect: Runs every queued submission in order and posts a completion for each.
+ *			Stops early when the completion ring is full, the rest stay queued.
+ */
+int32_t syscall_ring_enter(void){
+	syscall_ring_t* ring = (syscall_ring_t*)RING_ADDR;
+	ring_sqe_t sqe;
+	ring_cqe_t* cqe;
+	uint32_t head, tail;
+	int32_t done = 0;
+
+	if(tasks_running == -1)
+		return -1;
+
+	head = ring->sq_head;
+	tail = ring->sq_tail;
+	if((tail - head > RING_ENTRIES) || (ring->cq_tail - ring->cq_head > RING_ENTRIES))
+		return -1;
+
+	while((head != tail) && (ring->cq_tail - ring->cq_head < RING_ENTRIES)) {
+		// Copy the entry out first, the operation may overwrite the ring
+		sqe = ring->sq[head & (RING_ENTRIES - 1)];
+		ring->sq_head = ++head;
+
+		cqe = &ring->cq[ring->cq_tail & (RING_ENTRIES - 1)];
+		cqe->result = ring_op(&sqe);
+		cqe->user_data = sqe.user_data;
+		ring->cq_tail++;
+		done++;
+	}
+	return done;
+}
+
+/* demand_page()
+ * Input: faulting address from cr2
+ * Return: 0 if the page was loaded, -1 if the fault was a real error
+ * Effect: Backs the faulting 4kb page of the program page with a fresh frame,
+ *			zeroes it and copies in the part of the executable that belongs there
+ */
+int32_t demand_page(uint32_t addr) {
+	uint32_t page, page_addr, start, end, frame;
+	pcb_t* pcb;
+
+	// Only the running task's program page is loaded lazily
+	if((tasks_running == -1) || (addr < virtual_mem) || (addr >= virtual_mem + fourM))
+		return -1;
+	pcb = get_pcb(tasks_running);
+
+	page = (addr - virtual_mem) / fourK;
+	page_addr = virtual_mem + page * fourK;
+	frame = frame_alloc();
+	if(frame == 0)
+		return -1;
+	user_page_map(pcb->user_table, page, frame);
+	memset((void*)page_addr, 0, fourK);
+
+	// Copy in the piece of the executable overlapping this page, the rest stays zero (bss, stack)
+	start = page_addr;
+	end = page_addr + fourK;
+	if(start < program_addr)
+		start = program_addr;
+	if(end > program_addr + pcb->exe_length)
+		end = program_addr + pcb->exe_length;
+	if(start < end)
+		read_data(pcb->exe_inode, start - program_addr, (char*)start, end - start);
+
+	return 0;
+}
+
+/* cow_page()
+ * Input: faulting address from cr2
+ * Return: 0 if the page was copied, -1 if the fault was a real error
+ * Effect: Gives the running task its own copy of a copy on write page. The last
+ *			user of a frame just gets it back writable.
+ */
+int32_t cow_page(uint32_t addr) {
+	uint32_t page, entry, frame, copy;
+	pcb_t* pcb;
+
+	if((tasks_running == -1) || (addr < virtual_mem) || (addr >= virtual_mem + fourM))
+		return -1;
+	pcb = get_pcb(tasks_running);
+
+	page = (addr - virtual_mem) / fourK;
+	entry = pcb->user_table[page];
+	if(!(entry & PAGE_COW))
+		return -1;
+	frame = entry & ~(fourK - 1);
+
+	if(frame_refcount(frame) > 1) {
+		copy = frame_alloc();
+		if(copy == 0)
+			return -1;
+		// Frames are identity mapped, copy without going through user addresses
+		memcpy((void*)copy, (void*)frame, fourK);
+		frame_free(frame);
+		frame = copy;
+	}
+	user_page_map(pcb->user_table, page, frame);
+	flush_TLB();
+	return 0;
+}
+
 /* get_pcb()
  * Input: task id of pcb to grab
- * Return: pointer to pcb specified
+ * Return: pointer to pcb specified, NULL if the task doesn't exist
  * Effect: helper function to grab a pcb pointer
  */
 pcb_t* get_pcb(uint32_t grab_task_id) {
-	return (pcb_t*)(eightK * oneK - (eightK * (grab_task_id + 1)));
+	if(grab_task_id >= MAX_TASKS)
+		return NULL;
+	return pcb_table[grab_task_id];
+}
+
+/* kernel_stack_top()
+ * Input: task id of the kernel stack to find
+ * Return: address tss.esp0 should hold while the task runs
+ * Effect: helper function, kernel stacks sit right above each pcb in the same 8kb
+ */
+uint32_t kernel_stack_top(uint32_t task_id) {
+	return (uint32_t)pcb_table[task_id] + eightK - 4;
 }
 
 /* fda_init()
- * Input: none
+ * Input: pcb of the new task, task to take stdin and stdout from or NULL
  * Return: success or failure
- * Effect: fda initialization function, stdin and stdout is allocated
+ * Effect: fda initialization function, stdin and stdout is allocated. They are
+ *			copies of the parent's fds 0 and 1, the terminal for a base shell.
  */
-int32_t fda_init() {
+int32_t fda_init(pcb_t* pcb, pcb_t* parent) {
 
-	//get current file descriptor array from pcb
-	pcb_t* pcb = get_pcb(tasks_running);
+	//get file descriptor array from pcb
 	file_descriptor_t* fd_array = pcb->fd;
 
 	//initialize all 8 "files"
@@ -572,6 +1567,12 @@ int32_t fda_init() {
 	fd_array[0].flags = 1;
 	fd_array[1].flags = 1;
 
+	//a parent that redirected them hands on its pipes or files instead
+	if(parent != NULL) {
+		fd_dup(&parent->fd[0], &fd_array[0]);
+		fd_dup(&parent->fd[1], &fd_array[1]);
+	}
+
 	return 0;
 }
 
@@ -597,16 +1598,24 @@ void set_exception_death() {
 /* find_open_task()
  * Input: none
  * Return: open task index, -1 if fully
- * Effects: finds an open task slot for the new program to occupy
+ * Effects: finds an open task slot for the new program to occupy, reaping a
+ *			halted orphan if that is the only way to get one
  */
 int32_t find_open_task() {
 	int i;
-	for(i = 0; i < 6; i++) {
+	for(i = 0; i < MAX_TASKS; i++) {
 		// Check if empty slot, if so, return it
 		if(!task_slots[i]) {
 			return i;
 		}
 	}
+	for(i = 0; i < MAX_TASKS; i++) {
+		// Halted orphans have nobody left to wait for them
+		if((pcb_table[i] != NULL) && (pcb_table[i]->state == TASK_ZOMBIE) && (pcb_table[i]->task_id_parent == -1) && (i != tasks_running)) {
+			task_reap(i);
+			return i;
+		}
+	}
 	// No open slots
 	return -1;
 }
@@ -654,3 +1663,22 @@ int32_t switch_running_task(uint32_t task_num) {
 
 
 
+
+/* set_tasks_running()
+ * Input: task id the scheduler is switching to
+ * Return: none
+ * Effect: Changes the tasks_running var, used by the scheduler on a context switch
+ */
+void set_tasks_running(uint32_t task_id) {
+	tasks_running = task_id;
+}
+
+/* execute_terminal_shell()
+ * Input: terminal the shell belongs to
+ * Return: only returns on failure, -1
+ * Effect: Starts the base shell of a terminal, it has no parent and is never blocked on
+ */
+int32_t execute_terminal_shell(uint32_t t_num) {
+	shell_terminal = t_num;
+	return syscall_execute((const uint8_t*)"shell");
+}
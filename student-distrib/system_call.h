@@ -5,6 +5,7 @@
 #define _SYSTEM_CALL_H
 
 #include "types.h"
+#include "wait_queue.h"
 
 #define SPACE_CHAR 0x20
 #define NULL_CHAR 0x00
@@ -27,12 +28,104 @@
 #define eip_offset 6
 #define twoM 0x200000
 
+#define MAX_TASKS 64
+
+// Scheduling states of a task
+#define TASK_RUNNABLE 0
+#define TASK_WAITING 1			//blocked in execute until its child halts
+#define TASK_BLOCKED 2			//sleeping on a wait queue
+#define TASK_ZOMBIE 3			//forked or spawned task that halted, waiting to be reaped
+
+// User iret frame plus the six registers and three latency sample words syscall_handler_asm pushes
+#define SYSCALL_FRAME_SIZE 56
+
+// syscall_wait option, return 0 instead of sleeping when no child has halted yet
+#define WAIT_NOHANG 1
+
+// syscall_create flags, empty the file / start writing at its end
+#define CREATE_TRUNC 1
+#define CREATE_APPEND 2
+
+// Most buffers one readv/writev call takes
+#define IOV_MAX 16
+
+// One buffer of a readv/writev call
+typedef struct iovec_t {
+	void* base;
+	int32_t len;
+}iovec_t;
+
+// syscall_ioctl requests, IOCTL_TERM_MODE takes the TERM_ flags or'd together (0 is line input)
+// and returns the ones it replaced, IOCTL_TERM_GET only returns them
+#define IOCTL_TERM_MODE 1
+#define IOCTL_TERM_GET 2
+#define TERM_RAW 1				//reads return key_event_t presses and releases as they happen, no echo
+#define TERM_NONBLOCK 2			//reads return 0 at once when there is no input
+
+// Most fds one poll call watches, one per fd slot
+#define POLL_MAX 8
+// poll events, POLLNVAL is only returned for fds that aren't open or can't be polled
+#define POLLIN 1
+#define POLLOUT 2
+#define POLLNVAL 4
+
+// One fd of a poll call
+typedef struct pollfd_t {
+	int32_t fd;
+	uint16_t events;				//what the caller waits for
+	uint16_t revents;				//what is ready, filled in by poll
+}pollfd_t;
+
+// Submission/completion ring shared with a task at the bottom of its program page
+#define RING_ADDR 0x08000000
+#define RING_ENTRIES 64				//power of 2, indices run freely and wrap with a mask
+// Ring operations use the matching syscall numbers
+#define RING_OP_READ 3
+#define RING_OP_WRITE 4
+#define RING_OP_OPEN 5
+#define RING_OP_CLOSE 6
+#define RING_OP_READV 16
+#define RING_OP_WRITEV 17
+
+typedef struct ring_sqe_t {
+	int32_t opcode;
+	int32_t arg1;
+	int32_t arg2;
+	int32_t arg3;
+	uint32_t user_data;				//handed back untouched in the completion
+}ring_sqe_t;
+
+typedef struct ring_cqe_t {
+	uint32_t user_data;
+	int32_t result;
+}ring_cqe_t;
+
+// The user fills sq and moves sq_tail, the kernel moves sq_head and cq_tail, the user moves cq_head
+typedef struct syscall_ring_t {
+	uint32_t sq_head;
+	uint32_t sq_tail;
+	uint32_t cq_head;
+	uint32_t cq_tail;
+	ring_sqe_t sq[RING_ENTRIES];
+	ring_cqe_t cq[RING_ENTRIES];
+}syscall_ring_t;
+
 typedef struct fops_table_t {
 
 	int32_t (*open)(int32_t*, char*);
 	int32_t (*close)(int32_t*);
 	int32_t (*read)(int32_t*, uint32_t*, char*, uint32_t);
 	int32_t (*write)(int32_t*, uint32_t*, char*, uint32_t);
+	//optional vectored versions, NULL falls back to one read/write per buffer
+	int32_t (*readv)(int32_t*, uint32_t*, iovec_t*, int32_t);
+	int32_t (*writev)(int32_t*, uint32_t*, iovec_t*, int32_t);
+	//optional device control, NULL makes syscall_ioctl fail
+	int32_t (*ioctl)(int32_t*, int32_t, int32_t);
+	//gives a copied fd (fork, dup2, a child's stdin/stdout) its own reference, NULL just copies the fd
+	int32_t (*dup)(int32_t, int32_t*);
+	//POLLIN/POLLOUT that would not block now, arranges a poll_wake() for when that changes.
+	//Called with interrupts off, NULL can't be polled
+	int32_t (*poll)(int32_t*, uint32_t*);
 
 }fops_table_t;
 
@@ -69,6 +162,31 @@ typedef struct pcb_t {
     uint32_t old_esp;
     uint32_t old_eip;
 
+    //scheduling info, kernel stack is saved here when the pit switches tasks
+    uint32_t terminal_id;
+    uint32_t state;
+    uint32_t sched_ebp;
+    uint32_t sched_esp;
+    uint32_t vidmap_flag;
+    int32_t wait_next;                        //next task sleeping on the same wait queue
+
+    //fd whose file is mapped at 152MB by syscall_mmap, -1 if none
+    int32_t mmap_fd;
+
+    //executable the program page is loaded from on demand
+    uint32_t exe_inode;
+    uint32_t exe_length;
+
+    //1 for tasks made by fork or spawn, they halt into a zombie instead of returning to execute
+    uint32_t async;
+    int32_t exit_status;
+    //sleeps here in syscall_wait until a child halts
+    wait_queue_t child_queue;
+
+    //page tables for the program page and the file mapping, file_table is NULL until the first mmap
+    uint32_t* user_table;
+    uint32_t* file_table;
+
     //buffer for arguments of this task
     uint8_t argument_buf [ARGUMENT_SIZE];              //128 is max argument length, +1 for newline char
 
@@ -85,13 +203,39 @@ int32_t syscall_open(const uint8_t* filename);
 int32_t syscall_close(int32_t fd);
 int32_t syscall_getargs(uint8_t* buf, int32_t nbytes);
 int32_t syscall_vidmap(uint8_t ** screen_start); 
+int32_t syscall_set_handler(int32_t signum, void* handler_address);
+int32_t syscall_sigreturn(void);
+int32_t syscall_mmap(int32_t fd, uint8_t** start);
+int32_t file_mapped(uint32_t inode);
+int32_t syscall_fork(void);
+int32_t syscall_spawn(const uint8_t* command);
+int32_t syscall_wait(int32_t pid, int32_t* status, int32_t options);
+int32_t syscall_create(const uint8_t* filename, int32_t flags);
+int32_t syscall_readv(uint32_t fd, iovec_t* iov, int32_t iovcnt);
+int32_t syscall_writev(uint32_t fd, iovec_t* iov, int32_t iovcnt);
+int32_t syscall_ring_setup(syscall_ring_t** ring);
+int32_t syscall_ring_enter(void);
+int32_t syscall_ioctl(uint32_t fd, int32_t request, int32_t arg);
+int32_t syscall_poll(pollfd_t* fds, int32_t nfds, int32_t timeout);
+int32_t syscall_pipe(int32_t* fds);
+int32_t syscall_dup2(int32_t oldfd, int32_t newfd);
+void poll_wake(void);
+void poll_tick(void);
 pcb_t* get_pcb(uint32_t grab_task_id);
-int32_t fda_init();
+int32_t fda_init(pcb_t* pcb, pcb_t* parent);
+int32_t parse_command(const uint8_t* command, uint8_t* task_name, uint8_t* argument);
 int32_t find_open_task();
 int32_t find_bottom_task(uint32_t task_num);
+int32_t execute_terminal_shell(uint32_t t_num);
+uint32_t kernel_stack_top(uint32_t task_id);
+int32_t demand_page(uint32_t addr);
+int32_t cow_page(uint32_t addr);
 
 extern uint32_t get_tasks_running();
 extern void set_exception_death();
 extern int32_t switch_running_task(uint32_t task_num);
+extern void set_tasks_running(uint32_t task_id);
+extern uint32_t task_slots[MAX_TASKS];
+extern pcb_t* pcb_table[MAX_TASKS];
 
 #endif /* _SYSTEM_CALL_H */
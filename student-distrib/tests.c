@@ -6,6 +6,13 @@
 #include "fs_module.h"
 #include "system_call.h"
 #include "paging.h"
+#include "frame.h"
+#include "exe_cache.h"
+#include "latency.h"
+#include "proc.h"
+#include "ramdisk.h"
+#include "vdso.h"
+#include "pipe.h"
 
 #define PASS 1
 #define FAIL 0
@@ -280,6 +287,456 @@ int fs_test_list_dir(){
 	return PASS;
 }
 
+/* File system name index test
+ *
+ * looks up every directory entry through the name index
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: fs_module.c/h
+ */
+int fs_test_dentry_hash(){
+	TEST_HEADER;
+
+	dentry_t by_index, by_name;
+	char name[MAX_FILENAME + 1];
+
+	int i = 0;
+	for(i = 0; read_dentry_by_index(i, &by_index) == 0; i++){
+
+		//32 char names have no terminating 0x0 in the dentry
+		strncpy(name, by_index.name, MAX_FILENAME);
+		name[MAX_FILENAME] = '\0';
+
+		if(read_dentry_by_name(name, &by_name) == -1 || by_name.inode != by_index.inode)
+			return FAIL;
+	}
+
+	//prefixes and over long names must miss
+	if(read_dentry_by_name("verylargetextwithverylongname.txt", &by_name) == 0)
+		return FAIL;
+	if(read_dentry_by_name("frame0.tx", &by_name) == 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/* frame allocator test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, every frame taken is given back
+ * Coverage: frame_alloc, frames_alloc, frame_free
+ * Files: frame.c/h
+ */
+int frame_alloc_test(){
+	TEST_HEADER;
+
+	uint32_t before = frames_available();
+	uint32_t a, b, pair;
+
+	a = frame_alloc();
+	b = frame_alloc();
+	if(a == 0 || b == 0 || a == b || (a & (FRAME_SIZE - 1)) || a < FRAME_POOL_START)
+		return FAIL;
+	if(frames_available() != before - 2)
+		return FAIL;
+
+	//frames are identity mapped, so they must be writable right away
+	*(uint32_t*)a = 0xECE391;
+	if(*(uint32_t*)a != 0xECE391)
+		return FAIL;
+
+	//a freed frame is the first one handed out again
+	frame_free(a);
+	if(frame_alloc() != a)
+		return FAIL;
+
+	pair = frames_alloc(2);
+	if(pair == 0 || pair == a || pair == b)
+		return FAIL;
+
+	frame_free(a);
+	frame_free(b);
+	frames_free(pair, 2);
+	if(frames_available() != before)
+		return FAIL;
+
+	return PASS;
+}
+
+/* copy on write sharing test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, the tables and frame are given back
+ * Coverage: user_pages_share, frame reference counts
+ * Files: paging.c/h, frame.c/h
+ */
+int cow_share_test(){
+	TEST_HEADER;
+
+	uint32_t* parent = (uint32_t*)frame_alloc();
+	uint32_t* child = (uint32_t*)frame_alloc();
+	uint32_t page = frame_alloc();
+	int result = PASS;
+
+	user_pages_init(parent);
+	user_page_map(parent, 1, page);
+	user_pages_share(parent, child);
+
+	//both sides see the same frame read only, the untouched pages stay unloaded
+	if(parent[1] != child[1] || (parent[1] & 0x2) || !(parent[1] & PAGE_COW))
+		result = FAIL;
+	if((parent[1] & ~(fourK - 1)) != page || frame_refcount(page) != 2)
+		result = FAIL;
+	if(child[0] & 0x1)
+		result = FAIL;
+
+	user_pages_free(child);
+	if(frame_refcount(page) != 1)
+		result = FAIL;
+	user_pages_free(parent);
+	if(frame_refcount(page) != 0)
+		result = FAIL;
+
+	frame_free((uint32_t)parent);
+	frame_free((uint32_t)child);
+	return result;
+}
+
+/* executable image cache test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Loads ls into the image cache
+ * Coverage: exe_cache_lookup, exe_cache_put, exe_cache_invalidate
+ * Files: exe_cache.c/h
+ */
+int exe_cache_test(){
+	TEST_HEADER;
+
+	dentry_t dentry;
+	exe_image_t* image;
+	exe_image_t spare;
+	uint32_t misses, hits;
+
+	if(read_dentry_by_name("ls", &dentry) == -1)
+		return FAIL;
+
+	//start from a miss, then the same inode must hit
+	exe_cache_invalidate(dentry.inode);
+	misses = exe_cache_misses;
+	hits = exe_cache_hits;
+	image = exe_cache_lookup(dentry.inode, &spare);
+	if(image == NULL || image == &spare || exe_cache_misses != misses + 1)
+		return FAIL;
+	if(exe_cache_lookup(dentry.inode, &spare) != image || exe_cache_hits != hits + 1 || image->pins != 2)
+		return FAIL;
+	exe_cache_put(image);
+
+	//invalidated while pinned, the entry goes at the last put
+	exe_cache_invalidate(dentry.inode);
+	if(image->valid || image->pages == NULL)
+		return FAIL;
+	exe_cache_put(image);
+	if(image->pages != NULL || image->pins != 0)
+		return FAIL;
+	image = exe_cache_lookup(dentry.inode, &spare);
+	exe_cache_put(image);
+	if(image->eip < program_addr || image->length != inode_length(dentry.inode))
+		return FAIL;
+
+	//the first page of the image is loaded read only
+	if(image->pages != NULL && ((image->pages[(program_addr - virtual_mem) / fourK] & 0x3) != 0x1))
+		return FAIL;
+
+	//text files aren't executables
+	if(read_dentry_by_name("frame0.txt", &dentry) == -1 || exe_cache_lookup(dentry.inode, &spare) != NULL)
+		return FAIL;
+
+	return PASS;
+}
+
+/* latency counter test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Adds samples to the invalid syscall row
+ * Coverage: syscall_latency_record, sysstat_show
+ * Files: latency.c/h, proc.c/h
+ */
+int latency_test(){
+	TEST_HEADER;
+
+	latency_t* lat = &syscall_latency[0];
+	uint32_t count = lat->count;
+	uint32_t switched = lat->switched;
+	uint32_t low = lat->hist[0];
+	uint32_t high = lat->hist[LATENCY_BUCKETS - 1];
+	static char buf[PROC_BUF_SIZE];
+
+	//out of range numbers land in the invalid row
+	syscall_latency_record(100, 10, context_switches);
+	syscall_latency_record(0, 0xFFFFFFFF, context_switches);
+	if(lat->count != count + 2 || lat->hist[0] != low + 1 || lat->hist[LATENCY_BUCKETS - 1] != high + 1)
+		return FAIL;
+	if(lat->max != 0xFFFFFFFF || lat->min > 10)
+		return FAIL;
+
+	//a sample that saw a task switch is only counted
+	syscall_latency_record(0, 10, context_switches - 1);
+	if(lat->count != count + 2 || lat->switched != switched + 1)
+		return FAIL;
+
+	//header and one row per syscall
+	if(sysstat_show(buf, PROC_BUF_SIZE) == 0 || strncmp(buf, "name count", 10) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/* writable file system test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Leaves an empty scratch.txt in the directory
+ * Coverage: fs_create, file_write, read_data, fs_truncate
+ * Files: fs_module.c/h, bcache.c/h, ramdisk.c/h
+ */
+int fs_write_test(){
+	TEST_HEADER;
+
+	dentry_t dentry, again;
+	int32_t inode;
+	uint32_t offset = 0;
+	uint32_t free_blocks = fs_free_blocks();
+	static char buf[FS_BLOCK_SIZE + 16];
+	int i;
+
+	if(fs_create("scratch.txt", &dentry) == -1 || dentry.type != 2)
+		return FAIL;
+	if(fs_create("scratch.txt", &again) == -1 || again.inode != dentry.inode)
+		return FAIL;
+	inode = dentry.inode;
+	fs_truncate(inode, 0);
+	free_blocks = fs_free_blocks();
+
+	//write across a block boundary, then a few bytes past a hole
+	for(i = 0; i < FS_BLOCK_SIZE + 16; i++)
+		buf[i] = 'a' + (i % 26);
+	if(file_write(&inode, &offset, buf, FS_BLOCK_SIZE + 16) != FS_BLOCK_SIZE + 16 || offset != FS_BLOCK_SIZE + 16)
+		return FAIL;
+	offset = 3 * FS_BLOCK_SIZE;
+	if(file_write(&inode, &offset, "end", 3) != 3 || inode_length(inode) != 3 * FS_BLOCK_SIZE + 3)
+		return FAIL;
+	if(fs_free_blocks() != free_blocks - 4)
+		return FAIL;
+
+	memset(buf, 0, sizeof(buf));
+	if(read_data(inode, FS_BLOCK_SIZE - 2, buf, 4) != 4 || strncmp(buf, "yzab", 4) != 0)
+		return FAIL;
+	if(read_data(inode, 2 * FS_BLOCK_SIZE, buf, 1) != 1 || buf[0] != 0)
+		return FAIL;
+	if(read_data(inode, 3 * FS_BLOCK_SIZE, buf, 16) != 3 || strncmp(buf, "end", 3) != 0)
+		return FAIL;
+
+	//truncating gives every block back
+	if(fs_truncate(inode, 0) == -1 || inode_length(inode) != 0 || fs_free_blocks() != free_blocks)
+		return FAIL;
+
+	return PASS;
+}
+
+/* Scatter read test
+ *
+ * Reads a large file into uneven buffers that straddle a block boundary
+ * and compares against a plain read_data
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: fs_module.c/h
+ */
+int fs_readv_test(){
+	TEST_HEADER;
+
+	dentry_t file0;
+	static char flat[5277], a[100], b[4000], c[2000];
+	iovec_t iov[4];
+	int32_t inode;
+	uint32_t offset = 50;
+
+	if(read_dentry_by_name("verylargetextwithverylongname.tx", &file0) == -1)
+		return FAIL;
+	inode = file0.inode;
+	if(read_data(inode, 0, flat, sizeof(flat)) != sizeof(flat))
+		return FAIL;
+
+	iov[0].base = a;
+	iov[0].len = sizeof(a);
+	iov[1].base = NULL;
+	iov[1].len = 0;
+	iov[2].base = b;
+	iov[2].len = sizeof(b);
+	iov[3].base = c;
+	iov[3].len = sizeof(c);
+
+	//the file ends partway into c
+	if(file_readv(&inode, &offset, iov, 4) != sizeof(flat) - 50 || offset != sizeof(flat))
+		return FAIL;
+	if(strncmp(a, flat + 50, sizeof(a)) != 0 || strncmp(b, flat + 150, sizeof(b)) != 0)
+		return FAIL;
+	if(strncmp(c, flat + 4150, sizeof(flat) - 4150) != 0)
+		return FAIL;
+	if(file_readv(&inode, &offset, iov, 4) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/* time page test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Turns interrupts on and waits three PIT ticks
+ * Coverage: vdso_pit_tick, the user mapping at VDSO_ADDR
+ * Files: vdso.c/h, paging.c/h, pit.c
+ */
+int vdso_test(){
+	TEST_HEADER;
+
+	volatile vdso_t* vdso = (volatile vdso_t*) VDSO_ADDR;
+	uint32_t start = vdso->pit_ticks;
+	uint64_t ns = vdso->ns_base;
+
+	sti();
+	while(vdso->pit_ticks < start + 3);
+
+	if(vdso->ns_base <= ns || (vdso->seq & 1))
+		return FAIL;
+	return PASS;
+}
+
+/* vt100 test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Clears terminal 2, which is not on the screen
+ * Coverage: cursor positioning, erase, SGR colors, a sequence split across writes
+ * Files: vt100.c/h, lib.c/h
+ */
+int vt100_test(){
+	TEST_HEADER;
+
+	terminal_t* t = &terminal[2];
+	uint16_t* row;
+
+	terminal_puts(2, "\x1b[2J\x1b[3;5Hx\x1b[31my\x1b[0mz", 22);
+	row = t->rows[(t->top_row + 2) % NUM_ROWS];
+	if(row[4] != ('x' | 0x0700) || row[5] != ('y' | 0x0400) || row[6] != ('z' | 0x0700))
+		return FAIL;
+	if(t->cursor_pos_x != 7 || t->cursor_pos_y != 2)
+		return FAIL;
+
+	//half a sequence waits for the next write
+	terminal_puts(2, "\x1b[", 2);
+	terminal_puts(2, "1;1H\x1b[K", 7);
+	if(t->cursor_pos_x != 0 || t->cursor_pos_y != 0 || t->vt.state != VT_GROUND)
+		return FAIL;
+
+	terminal_puts(2, "\x1b[2J", 4);
+	if(row[4] != (' ' | 0x0700))
+		return FAIL;
+	return PASS;
+}
+
+/* ldisc test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Echoes a line on terminal 2, which is not on the screen
+ * Coverage: key ring, backspace, a line read in two pieces
+ * Files: ldisc.c/h, keyboard.c/h
+ */
+int ldisc_test(){
+	TEST_HEADER;
+
+	ldisc_t* ld = &terminal[2].ldisc;
+	uint8_t* keys = (uint8_t*) "ab\bc\n";
+	uint8_t buf[8];
+	key_event_t ev = {0, 0, 0, 0};
+	int i;
+
+	for(i = 0; keys[i] != '\0'; i++) {
+		ev.ch = keys[i];
+		ldisc_key(ld, ev);
+	}
+	ldisc_run();
+
+	//the rest of a line stays for the next read
+	if(ldisc_read(2, buf, 2) != 2 || buf[0] != 'a' || buf[1] != 'c')
+		return FAIL;
+	if(ldisc_read(2, buf, 8) != 1 || buf[0] != '\n')
+		return FAIL;
+	return PASS;
+}
+
+/* pipe test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: data wrapping the end of the ring, poll, end of data once the writer closes
+ * Files: pipe.c/h
+ */
+int pipe_test(){
+	TEST_HEADER;
+
+	int32_t p = pipe_alloc();
+	int32_t rd, wr;
+	char buf[8];
+
+	if(p == -1)
+		return FAIL;
+	rd = p;
+	wr = p;
+	//start near the end so the write wraps around
+	pipes[p].head = PIPE_SIZE - 2;
+	pipes[p].tail = PIPE_SIZE - 2;
+	if(pipe_read_poll(&rd, NULL) != 0 || pipe_write_poll(&wr, NULL) != POLLOUT)
+		return FAIL;
+	if(pipe_write(&wr, NULL, "hello", 5) != 5 || pipe_read_poll(&rd, NULL) != POLLIN)
+		return FAIL;
+	if(pipe_read(&rd, NULL, buf, 8) != 5 || strncmp(buf, "hello", 5) != 0)
+		return FAIL;
+
+	//no writer left, an empty pipe reads as the end
+	pipe_write_close(&wr);
+	if(pipe_read_poll(&rd, NULL) != POLLIN || pipe_read(&rd, NULL, buf, 8) != 0)
+		return FAIL;
+	pipe_read_close(&rd);
+	if(pipes[p].buf != NULL)
+		return FAIL;
+	return PASS;
+}
+
+/* parse command test
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: blanks a shell leaves before a pipe's bar
+ * Files: system_call.c/h
+ */
+int parse_command_test(){
+	TEST_HEADER;
+
+	uint8_t line[] = "cat frame0.txt | grep x";
+	uint8_t name[TASKNAME_SIZE];
+	uint8_t arg[ARGUMENT_SIZE];
+	uint8_t* bar = (uint8_t*)"| grep x";
+
+	//cut at the bar like the shell, the space before it stays
+	line[15] = NULL_CHAR;
+	if(parse_command(line, name, arg) != 1 || strncmp((int8_t*)name, "cat", 4) != 0 || strncmp((int8_t*)arg, "frame0.txt", 11) != 0)
+		return FAIL;
+	if(parse_command(bar + 1, name, arg) != 1 || strncmp((int8_t*)name, "grep", 5) != 0 || strncmp((int8_t*)arg, "x", 2) != 0)
+		return FAIL;
+	if(parse_command((uint8_t*)"ls \t ", name, arg) != 1 || arg[0] != NULL_CHAR)
+		return FAIL;
+	return PASS;
+}
+
 /* rtc read write test
  * Inputs: None
  * Outputs: PASS
@@ -292,23 +749,26 @@ int rtc_read_write_test() {
 	int result = PASS;
 	int chars_in_line;
 	uint32_t i, j;
-	char z = 2;
+	uint32_t z = 2;
+	int32_t rtc_fd;
+	rtc_open(&rtc_fd, 0);
 	for(i = 0; i < 10; i++) {
 		chars_in_line = 0;
 		clear();
 		reset_position();
-		rtc_write(0, 0, &z, 4);
+		rtc_write(&rtc_fd, 0, (char*)&z, 4);
 		for(j = 0; j <= z; j++) {
 			if (chars_in_line >= 80) {
 				putc('\n');
 				chars_in_line = 0;
 			}
-			rtc_read(0, 0, 0, 0);
+			rtc_read(&rtc_fd, 0, 0, 0);
 			putc(i + 65);
 			chars_in_line++;
 		}
 		z *= 2;
 	}
+	rtc_close(&rtc_fd);
 	return result;
 }
 
@@ -324,23 +784,25 @@ int rtc_open_close_test() {
 	reset_position();
 	TEST_HEADER;
 	int i;
-	char write_val = 4;
-	rtc_open(0, 0);
+	uint32_t write_val = 4;
+	int32_t rtc_fd;
+	rtc_open(&rtc_fd, 0);
 	for(i = 0; i < 10; i++) {
-		rtc_read(0, 0, 0, 0);
+		rtc_read(&rtc_fd, 0, 0, 0);
 		putc('1');
 	}
-	rtc_write(0, 0, &write_val, 4);
+	rtc_write(&rtc_fd, 0, (char*)&write_val, 4);
 	for(i = 0; i < 10; i++) {
-		rtc_read(0, 0, 0, 0);
+		rtc_read(&rtc_fd, 0, 0, 0);
 		putc('2');
 	}
-	rtc_open(0, 0);
+	rtc_close(&rtc_fd);
+	rtc_open(&rtc_fd, 0);
 	for(i = 0; i < 10; i++) {
-		rtc_read(0, 0, 0, 0);
+		rtc_read(&rtc_fd, 0, 0, 0);
 		putc('3');
 	}
-	if(!rtc_close(0)) {
+	if(!rtc_close(&rtc_fd)) {
 		return PASS;
 	} else {
 		return FAIL;
@@ -348,6 +810,41 @@ int rtc_open_close_test() {
 
 }
 
+/* rtc virtual frequency test
+ * Inputs: None
+ * Outputs: PASS if each open rtc keeps its own rate, FAIL otherwise
+ * Side Effects: Waits a few virtual interrupts
+ * Coverage: per fd virtual rtc, timer wheel
+ * Files: rtc.c/h
+ */
+int rtc_virtual_test() {
+	TEST_HEADER;
+	int result = PASS;
+	int i;
+	int32_t fast_fd, slow_fd;
+	uint32_t fast_freq = 512;
+	uint32_t start;
+
+	if(rtc_open(&fast_fd, 0) || rtc_open(&slow_fd, 0))
+		return FAIL;
+	rtc_write(&fast_fd, 0, (char*)&fast_freq, 4);
+
+	// writing one fd must not retime the other
+	if(rtc_timers[slow_fd].period != RTC_HW_FREQ / RTC_DEFAULT_FREQ)
+		result = FAIL;
+
+	// 8 reads at 512 Hz take 16 ticks, far less than one 2 Hz period
+	start = rtc_ticks;
+	for(i = 0; i < 8; i++)
+		rtc_read(&fast_fd, 0, 0, 0);
+	if((rtc_ticks - start) > (RTC_HW_FREQ / fast_freq) * 9)
+		result = FAIL;
+
+	rtc_close(&fast_fd);
+	rtc_close(&slow_fd);
+	return result;
+}
+
 // int terminal_driver_test()
 // {
 
@@ -440,6 +937,7 @@ void launch_tests(){
 	/* RTC TESTS */
 	//TEST_OUTPUT("rtc_read_write_test", rtc_read_write_test());
 	//TEST_OUTPUT("rtc_open_close_test", rtc_open_close_test());
+	//TEST_OUTPUT("rtc_virtual_test", rtc_virtual_test());
 
 	//CP2
 
@@ -447,6 +945,18 @@ void launch_tests(){
 	//fs_test_read_large();
 	//fs_test_read_exe();
 	//fs_test_list_dir();
+	//TEST_OUTPUT("fs_test_dentry_hash", fs_test_dentry_hash());
+	//TEST_OUTPUT("frame_alloc_test", frame_alloc_test());
+	//TEST_OUTPUT("cow_share_test", cow_share_test());
+	//TEST_OUTPUT("exe_cache_test", exe_cache_test());
+	//TEST_OUTPUT("latency_test", latency_test());
+	//TEST_OUTPUT("fs_write_test", fs_write_test());
+	//TEST_OUTPUT("fs_readv_test", fs_readv_test());
+	//TEST_OUTPUT("vdso_test", vdso_test());
+	//TEST_OUTPUT("vt100_test", vt100_test());
+	//TEST_OUTPUT("ldisc_test", ldisc_test());
+	//TEST_OUTPUT("pipe_test", pipe_test());
+	//TEST_OUTPUT("parse_command_test", parse_command_test());
  //TEST_OUTPUT("terminal_driver_test",terminal_driver_test());
 	// launch your tests here
 	//system_execute_test();
@@ -0,0 +1,101 @@
+/* vdso.c
+ * Time page mapped read only into every task. The PIT and RTC handlers keep it
+ * current so programs can read the time without a syscall. Writers bump seq to
+ * odd, update, then bump it back to even; a reader that sees seq odd or changed
+ * across its copy reads again.
+ */
+
+#include "vdso.h"
+#include "paging.h"
+#include "lib.h"
+
+// The page is handed to user space whole, nothing else may share it
+static uint8_t vdso_frame[fourK] __attribute__((aligned (fourK)));
+static volatile vdso_t* const vdso = (volatile vdso_t*) vdso_frame;
+
+// TSC at the first PIT tick, calibration measures from here
+static uint32_t calibrate_start;
+
+/* rdtsc_low()
+ * Input: none
+ * Return: low half of the time stamp counter
+ * Effect: none
+ */
+static uint32_t rdtsc_low(void) {
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return lo;
+}
+
+/* vdso_init()
+ * Input: none
+ * Return: none
+ * Effect: clears the time page and maps it at VDSO_ADDR, needs paging on
+ */
+void vdso_init(void) {
+	memset(vdso_frame, 0, fourK);
+	vdso_page_map(VDSO_ADDR, (uint32_t) vdso_frame);
+}
+
+/* vdso_pit_tick()
+ * Input: none
+ * Return: none
+ * Effect: Called from the PIT handler with interrupts off. Counts the tick and
+ *			moves the clock forward. Until the TSC is calibrated the clock steps
+ *			a whole tick at a time, after that it follows the TSC.
+ */
+void vdso_pit_tick(void) {
+	uint32_t now = rdtsc_low();
+	uint32_t cycles, quot, rem;
+
+	vdso->seq++;
+	vdso->pit_ticks++;
+
+	if(vdso->tsc_mult != 0) {
+		vdso->ns_base += ((uint64_t)(now - vdso->tsc_base) * vdso->tsc_mult) >> VDSO_MULT_SHIFT;
+	} else {
+		vdso->ns_base += VDSO_NS_PER_TICK;
+		if(vdso->pit_ticks == 1) {
+			calibrate_start = now;
+		} else if(vdso->pit_ticks == VDSO_CALIBRATE_TICKS + 1) {
+			// (ns per tick << shift) / cycles per tick, divl takes the 64 bit dividend in edx:eax
+			cycles = (now - calibrate_start) / VDSO_CALIBRATE_TICKS;
+			if(cycles > (VDSO_NS_PER_TICK >> (32 - VDSO_MULT_SHIFT))) {
+				asm volatile("divl %4"
+					: "=a" (quot), "=d" (rem)
+					: "a" ((uint32_t)VDSO_NS_PER_TICK << VDSO_MULT_SHIFT), "d" (VDSO_NS_PER_TICK >> (32 - VDSO_MULT_SHIFT)), "r" (cycles)
+					: "cc");
+				vdso->tsc_mult = quot;
+			}
+		}
+	}
+	vdso->tsc_base = now;
+
+	vdso->seq++;
+}
+
+/* vdso_rtc_tick()
+ * Input: rtc interrupts since boot
+ * Return: none
+ * Effect: publishes the rtc count, called from the RTC handler with interrupts off
+ */
+void vdso_rtc_tick(uint32_t ticks) {
+	vdso->seq++;
+	vdso->rtc_ticks = ticks;
+	vdso->seq++;
+}
+
+/* vdso_set_terminal()
+ * Input: terminal now on the screen
+ * Return: none
+ * Effect: publishes the displayed terminal
+ */
+void vdso_set_terminal(uint32_t tid) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	vdso->seq++;
+	vdso->display_terminal = tid;
+	vdso->seq++;
+	restore_flags(flags);
+}
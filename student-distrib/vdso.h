@@ -0,0 +1,34 @@
+/* vdso.h
+ */
+
+#ifndef _VDSO_H
+#define _VDSO_H
+
+#include "types.h"
+
+// Every task sees the time page read only here, in its own 4MB slot after the file mapping
+#define VDSO_ADDR 0x9C00000
+// ns_base advances by TSC cycles times tsc_mult >> VDSO_MULT_SHIFT
+#define VDSO_MULT_SHIFT 24
+// PIT ticks the TSC is timed over before tsc_mult is set, half a second at 50 Hz
+#define VDSO_CALIBRATE_TICKS 25
+// RELOAD_VAL / 1193182 Hz, the nanoseconds a PIT tick lasts
+#define VDSO_NS_PER_TICK 19999464
+
+// Layout shared with user programs, see syscalls/ece391syscall.h
+typedef struct vdso_t {
+	uint32_t seq;					//odd while the kernel is updating the page, readers retry
+	uint32_t pit_ticks;
+	uint32_t rtc_ticks;
+	uint32_t display_terminal;		//terminal on the screen
+	uint32_t tsc_mult;				//ns per cycle << VDSO_MULT_SHIFT, 0 until calibrated
+	uint32_t tsc_base;				//low half of the TSC when ns_base was set
+	uint64_t ns_base;				//nanoseconds since boot at tsc_base
+} vdso_t;
+
+void vdso_init(void);
+void vdso_pit_tick(void);
+void vdso_rtc_tick(uint32_t ticks);
+void vdso_set_terminal(uint32_t tid);
+
+#endif /* _VDSO_H */
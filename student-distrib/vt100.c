@@ -0,0 +1,162 @@
+/* vt100.c
+ * Escape sequence parser for the terminals. It only splits the byte stream into
+ * text and finished sequences and keeps the SGR colors; lib.c moves the cursor
+ * and edits the rows a sequence asks for.
+ */
+
+#include "vt100.h"
+#include "lib.h"
+
+// ANSI color order (black red green yellow blue magenta cyan white) to VGA's
+static const uint8_t ansi_to_vga[VT_COLORS] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+/* vt100_init()
+ * Input: parser state to reset
+ * Return: none
+ * Effect: default colors, the whole screen as scroll region, no sequence pending
+ */
+void vt100_init(vt100_t* vt) {
+	memset(vt, 0, sizeof(vt100_t));
+	vt->state = VT_GROUND;
+	vt->fg = VT_DEFAULT_ATTRIB & 0x0F;
+	vt->bg = VT_DEFAULT_ATTRIB >> 4;
+	vt->attrib = VT_DEFAULT_ATTRIB;
+	vt->scroll_top = 0;
+	vt->scroll_bottom = NUM_ROWS - 1;
+}
+
+/* vt100_feed()
+ * Input: parser state, next byte written to the terminal
+ * Return: VT_PRINT, VT_NONE, VT_ESC_DONE or VT_CSI_DONE
+ * Effect: Advances the state machine. A sequence may be split across writes.
+ */
+int32_t vt100_feed(vt100_t* vt, uint8_t c) {
+	uint32_t* p;
+
+	switch(vt->state) {
+	case VT_GROUND:
+		if(c != VT_ESC)
+			return VT_PRINT;
+		vt->state = VT_ESCAPE;
+		return VT_NONE;
+
+	case VT_ESCAPE:
+		if(c == '[') {
+			vt->state = VT_CSI;
+			vt->private = 0;
+			vt->count = 1;
+			memset(vt->params, 0, sizeof(vt->params));
+			return VT_NONE;
+		}
+		//ESC ( B and friends pick character sets, there is only one
+		if(c >= 0x20 && c <= 0x2F) {
+			vt->state = VT_ESC_INTER;
+			return VT_NONE;
+		}
+		vt->state = VT_GROUND;
+		vt->final = c;
+		return VT_ESC_DONE;
+
+	case VT_ESC_INTER:
+		vt->state = VT_GROUND;
+		return VT_NONE;
+
+	case VT_CSI:
+		if(c >= '0' && c <= '9') {
+			if(vt->count > VT_MAX_PARAMS)
+				return VT_NONE;
+			p = &vt->params[vt->count - 1];
+			*p = *p * 10 + (c - '0');
+			if(*p > VT_MAX_VALUE)
+				*p = VT_MAX_VALUE;
+			return VT_NONE;
+		}
+		if(c == ';') {
+			if(vt->count <= VT_MAX_PARAMS)
+				vt->count++;
+			return VT_NONE;
+		}
+		if(c == '?') {
+			vt->private = 1;
+			return VT_NONE;
+		}
+		//a new ESC abandons the sequence
+		if(c == VT_ESC) {
+			vt->state = VT_ESCAPE;
+			return VT_NONE;
+		}
+		if(c >= 0x40 && c <= 0x7E) {
+			vt->state = VT_GROUND;
+			vt->final = c;
+			if(vt->count > VT_MAX_PARAMS)
+				vt->count = VT_MAX_PARAMS;
+			return VT_CSI_DONE;
+		}
+		//intermediate bytes, nothing here uses them
+		return VT_NONE;
+	}
+
+	vt->state = VT_GROUND;
+	return VT_PRINT;
+}
+
+/* vt100_param()
+ * Input: parser state, which parameter, value to use when it is missing or 0
+ * Return: the parameter
+ * Effect: none
+ */
+uint32_t vt100_param(vt100_t* vt, uint32_t i, uint32_t def) {
+	if(i >= vt->count || vt->params[i] == 0)
+		return def;
+	return vt->params[i];
+}
+
+/* vt100_sgr()
+ * Input: parser state holding a finished ESC [ ... m
+ * Return: none
+ * Effect: Applies the color and style parameters and rebuilds attrib. Bold
+ *			is the bright foreground, reverse swaps the colors.
+ */
+void vt100_sgr(vt100_t* vt) {
+	uint32_t i, n;
+	uint8_t fg, bg;
+
+	for(i = 0; i < vt->count; i++) {
+		n = vt->params[i];
+		if(n == 0) {
+			vt->fg = VT_DEFAULT_ATTRIB & 0x0F;
+			vt->bg = VT_DEFAULT_ATTRIB >> 4;
+			vt->bold = 0;
+			vt->reverse = 0;
+		} else if(n == 1) {
+			vt->bold = 1;
+		} else if(n == 7) {
+			vt->reverse = 1;
+		} else if(n == 22) {
+			vt->bold = 0;
+		} else if(n == 27) {
+			vt->reverse = 0;
+		} else if(n >= VT_SGR_FG && n < VT_SGR_FG + VT_COLORS) {
+			vt->fg = ansi_to_vga[n - VT_SGR_FG];
+		} else if(n == VT_SGR_FG + 9) {
+			vt->fg = VT_DEFAULT_ATTRIB & 0x0F;
+		} else if(n >= VT_SGR_BG && n < VT_SGR_BG + VT_COLORS) {
+			vt->bg = ansi_to_vga[n - VT_SGR_BG];
+		} else if(n == VT_SGR_BG + 9) {
+			vt->bg = VT_DEFAULT_ATTRIB >> 4;
+		} else if(n >= VT_SGR_FG_BRIGHT && n < VT_SGR_FG_BRIGHT + VT_COLORS) {
+			vt->fg = ansi_to_vga[n - VT_SGR_FG_BRIGHT] | 0x08;
+		} else if(n >= VT_SGR_BG_BRIGHT && n < VT_SGR_BG_BRIGHT + VT_COLORS) {
+			//the top background bit blinks on VGA, bright backgrounds stay dark
+			vt->bg = ansi_to_vga[n - VT_SGR_BG_BRIGHT];
+		}
+	}
+
+	fg = vt->fg | (vt->bold ? 0x08 : 0);
+	bg = vt->bg;
+	if(vt->reverse) {
+		bg = fg & 0x07;
+		fg = vt->bg | (vt->bold ? 0x08 : 0);
+	}
+	vt->attrib = (bg << 4) | fg;
+}
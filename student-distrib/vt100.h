@@ -0,0 +1,53 @@
+/* vt100.h
+ */
+
+#ifndef _VT100_H
+#define _VT100_H
+
+#include "types.h"
+
+#define VT_ESC 0x1B
+#define VT_MAX_PARAMS 8					//parameters kept per sequence, later ones are dropped
+#define VT_MAX_VALUE 9999				//largest parameter kept, bigger ones are clamped
+#define VT_DEFAULT_ATTRIB 0x07			//light gray on black
+
+// Parser states
+#define VT_GROUND 0						//printing
+#define VT_ESCAPE 1						//seen ESC
+#define VT_ESC_INTER 2					//seen ESC and an intermediate byte, the next byte ends it
+#define VT_CSI 3						//seen ESC [
+
+// What vt100_feed() made of a byte
+#define VT_NONE 0						//part of a sequence that is not done yet
+#define VT_PRINT 1						//not part of a sequence, print it
+#define VT_ESC_DONE 2					//ESC sequence done, its byte is in final
+#define VT_CSI_DONE 3					//ESC [ sequence done, see final, params and count
+
+// SGR colors, as offsets into the 30-37 and 40-47 ranges
+#define VT_SGR_FG 30
+#define VT_SGR_BG 40
+#define VT_SGR_FG_BRIGHT 90
+#define VT_SGR_BG_BRIGHT 100
+#define VT_COLORS 8
+
+// Escape sequence state of one terminal
+typedef struct vt100_t {
+	uint32_t state;
+	uint32_t private;				//1 if the ESC [ sequence started with '?'
+	uint32_t params[VT_MAX_PARAMS];	//missing parameters read as 0
+	uint32_t count;					//parameters given, at least 1 once a sequence is done
+	uint8_t final;					//byte that ended the sequence
+	uint8_t attrib;					//VGA attribute new characters are drawn with
+	uint8_t fg, bg;					//VGA colors SGR picked, attrib also has bold and reverse folded in
+	uint8_t bold, reverse;
+	uint32_t scroll_top;			//rows a scroll at the bottom moves, inclusive
+	uint32_t scroll_bottom;
+	uint32_t saved_x, saved_y;		//cursor kept by ESC 7 and ESC [ s
+} vt100_t;
+
+void vt100_init(vt100_t* vt);
+int32_t vt100_feed(vt100_t* vt, uint8_t c);
+uint32_t vt100_param(vt100_t* vt, uint32_t i, uint32_t def);
+void vt100_sgr(vt100_t* vt);
+
+#endif /* _VT100_H */
@@ -0,0 +1,72 @@
+/* wait_queue.c
+ * Lets a task sleep in the kernel until an interrupt handler signals the event it waits on
+ */
+
+#include "wait_queue.h"
+#include "scheduler.h"
+#include "lib.h"
+
+/* wait_queue_init()
+ * Input: queue to initialize
+ * Return: none
+ * Effect: marks the queue as having no sleeping tasks
+ */
+void wait_queue_init(wait_queue_t* queue) {
+	queue->head = -1;
+}
+
+/* sleep_on()
+ * Input: queue to sleep on
+ * Return: none
+ * Effect: Blocks the running task until wake_up() is called on the queue. Must be called
+ *			with interrupts off after checking the wait condition, and returns with them off,
+ *			so the caller should recheck the condition in a loop.
+ */
+void sleep_on(wait_queue_t* queue) {
+	int32_t curr_task = get_tasks_running();
+	pcb_t* pcb;
+
+	// No task yet (boot time tests), just wait for the next interrupt
+	if(curr_task == -1) {
+		asm volatile(
+		"sti \n"
+		"hlt \n"
+		"cli \n"
+		:
+		:
+		:"memory"
+		);
+		return;
+	}
+	pcb = get_pcb(curr_task);
+
+	// Push the task onto the queue and take it out of the run queue
+	pcb->wait_next = queue->head;
+	queue->head = curr_task;
+	pcb->state = TASK_BLOCKED;
+
+	// Give the cpu away until the event happens
+	schedule();
+}
+
+/* wake_up()
+ * Input: queue to wake
+ * Return: none
+ * Effect: Makes every task sleeping on the queue runnable again, safe to call from irq handlers
+ */
+void wake_up(wait_queue_t* queue) {
+	int32_t task;
+	pcb_t* pcb;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	task = queue->head;
+	while(task != -1) {
+		pcb = get_pcb(task);
+		task = pcb->wait_next;
+		pcb->wait_next = -1;
+		pcb->state = TASK_RUNNABLE;
+	}
+	queue->head = -1;
+	restore_flags(flags);
+}
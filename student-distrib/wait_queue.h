@@ -0,0 +1,18 @@
+/* wait_queue.h
+ */
+
+#ifndef _WAIT_QUEUE_H
+#define _WAIT_QUEUE_H
+
+#include "types.h"
+
+// A list of tasks sleeping on the same event, linked through pcb->wait_next
+typedef struct wait_queue_t {
+	int32_t head;			//task id of first sleeping task, -1 if empty
+} wait_queue_t;
+
+void wait_queue_init(wait_queue_t* queue);
+void sleep_on(wait_queue_t* queue);
+void wake_up(wait_queue_t* queue);
+
+#endif /* _WAIT_QUEUE_H */
@@ -6,17 +6,18 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+/* 
+ * Prints the lines read from fd that contain s, each after "fname:".
+ * fname is 0 for standard input, whose lines are printed alone.
+ */
 int32_t
-do_one_file (const char* s, const char* fname) 
+do_one_fd (const char* s, int32_t fd, const char* fname) 
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
+    int32_t cnt, last, line_start, line_end, check, s_len;
     uint8_t data[BUFSIZE+1];
+    iovec_t out[4];
 
     s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
-        return -1;
-    }
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -30,7 +31,9 @@ do_one_file (const char* s, const char* fname)
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
+	    /* a pipe can hand over part of a line, wait for the rest */
+	    if (line_end == last && 0 != cnt &&
+		(line_start != 0 || last < BUFSIZE)) {
 		/* copy from line_start to last down to 0 and fix last */
 		data[line_end] = '\0';
 		ece391_strcpy (data, data + line_start);
@@ -42,10 +45,20 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
+		    /* print "fname:line\n" with one call */
+		    out[2].base = data + line_start;
+		    out[2].len = line_end - line_start;
+		    out[3].base = "\n";
+		    out[3].len = 1;
+		    if (0 == fname) {
+			ece391_writev (1, out + 2, 2);
+			break;
+		    }
+		    out[0].base = (void*)fname;
+		    out[0].len = ece391_strlen ((uint8_t*)fname);
+		    out[1].base = ":";
+		    out[1].len = 1;
+		    ece391_writev (1, out, 4);
 		    break;
 		}
 	    }
@@ -58,6 +71,20 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    if (0 != do_one_fd (s, fd, fname))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -76,6 +103,10 @@ int main ()
         return 3;
     }
 
+    /* fed by a pipe or a file instead of the terminal, search that */
+    if (-1 == ece391_ioctl (0, IOCTL_TERM_GET, 0))
+	return (0 != do_one_fd ((char*)search, 0, 0)) ? 3 : 0;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
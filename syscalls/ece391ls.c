@@ -4,25 +4,64 @@
 #include "ece391syscall.h"
 
 #define SBUFSIZE 33
+#define BATCH IOV_MAX
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, i, n, done;
+    uint8_t names[BATCH][SBUFSIZE];
+    iovec_t out[BATCH];
+    syscall_ring_t* ring;
+    ring_sqe_t* sqe;
+    ring_cqe_t* cqe;
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
+    if (-1 == ece391_ring_setup (&ring)) {
+        ece391_fdputs (1, (uint8_t*)"ring setup failed\n");
+        return 3;
+    }
+
+    /* queue a batch of entry reads, run them with one call, print them with another */
+    done = 0;
+    while (!done) {
+        for (i = 0; i < BATCH; i++) {
+	    sqe = &ring->sq[ring->sq_tail % RING_ENTRIES];
+	    sqe->opcode = RING_OP_READ;
+	    sqe->arg1 = fd;
+	    sqe->arg2 = (int32_t)names[i];
+	    sqe->arg3 = SBUFSIZE-1;
+	    sqe->user_data = i;
+	    ring->sq_tail++;
+	}
+	if (BATCH != ece391_ring_enter ()) {
+	    ece391_fdputs (1, (uint8_t*)"ring enter failed\n");
+	    return 3;
+	}
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
-        if (-1 == cnt) {
+	n = 0;
+	while (ring->cq_head != ring->cq_tail) {
+	    cqe = &ring->cq[ring->cq_head % RING_ENTRIES];
+	    i = cqe->user_data;
+	    cnt = cqe->result;
+	    ring->cq_head++;
+	    if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+	    if (0 == cnt) {
+	        done = 1;
+		continue;
+	    }
+	    names[i][cnt] = '\n';
+	    out[n].base = names[i];
+	    out[n].len = cnt + 1;
+	    n++;
+	}
+	if (0 != n && -1 == ece391_writev (1, out, n))
+	    return 3;
     }
 
     return 0;
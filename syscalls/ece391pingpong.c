@@ -11,6 +11,34 @@
 #define LOOPMAX BUFMAX-ENDING-1
 #define STARTCHAR 'A'
 #define ENDCHAR 'Z'
+#define QUITCHAR 'q'
+
+/* Wait for the next RTC tick, reading keys as they come; 1 if q was pressed */
+static int32_t next_frame (int32_t rtc_fd)
+{
+    pollfd_t fds[2];
+    key_event_t ev[8];
+    int32_t cnt, i, garbage;
+
+    fds[0].fd = rtc_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = 0;
+    fds[1].events = POLLIN;
+    while (1) {
+	if (-1 == ece391_poll (fds, 2, -1))
+	    return 1;
+	if (fds[1].revents & POLLIN) {
+	    cnt = ece391_read (0, ev, sizeof (ev)) / sizeof (key_event_t);
+	    for (i = 0; i < cnt; i++)
+		if (QUITCHAR == ev[i].ch && !(ev[i].flags & KEY_RELEASED))
+		    return 1;
+	}
+	if (fds[0].revents & POLLIN) {
+	    ece391_read (rtc_fd, &garbage, 4);
+	    return 0;
+	}
+    }
+}
 
 int main ()
 {
@@ -19,7 +47,6 @@ int main ()
     uint8_t curchar = STARTCHAR;
     uint8_t update = 1;
     int ret_val;
-    int garbage;
     int rtc_fd;
     uint8_t buf[BUFMAX];
     
@@ -38,6 +65,9 @@ int main ()
     ret_val = 32;
     ret_val = ece391_write(rtc_fd, &ret_val, 4);
 
+    // Keys come in as they are pressed, q quits
+    ece391_ioctl (0, IOCTL_TERM_MODE, TERM_RAW);
+
     while(1)
     {
 	// Move out
@@ -54,7 +84,8 @@ int main ()
 		ece391_fdputs (1, buf);
 
 		// Wait for RTC tick
-		ece391_read(rtc_fd, &garbage, 4);
+		if (next_frame (rtc_fd))
+		    return 0;
 	}
 	
 	// Bounce back
@@ -71,7 +102,8 @@ int main ()
 		ece391_fdputs (1, buf);
 
 		// Wait for RTC tick
-		ece391_read(rtc_fd, &garbage, 4);
+		if (next_frame (rtc_fd))
+		    return 0;
     	}
 
 	// Edge case on characters
@@ -4,14 +4,85 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define MAX_STAGES 8
+
+/* 
+ * Runs "a | b | ..." with each command's output piped into the next one's
+ * input, then waits for all of them.  Returns the last command's status,
+ * -1 if it could not be started.
+ */
+static int32_t
+run_pipeline (uint8_t* cmd)
+{
+    int32_t pids[MAX_STAGES], fds[2], in, out, n, i, status, rval;
+    uint8_t* next;
+    uint8_t* end;
+
+    /* children copy fds 0 and 1, so point them at each pipe in turn */
+    in = ece391_dup2 (0, -1);
+    out = ece391_dup2 (1, -1);
+    if (-1 == in || -1 == out) {
+	ece391_fdputs (1, (uint8_t*)"no free fds\n");
+	return -1;
+    }
+    for (n = 0; 0 != cmd && n < MAX_STAGES; n++, cmd = next) {
+	for (next = cmd; '\0' != *next && '|' != *next; next++);
+	if ('|' == *next) {
+	    /* the blanks before the bar aren't part of the argument */
+	    for (end = next; end > cmd && (' ' == end[-1] || '\t' == end[-1]); end--);
+	    *end = '\0';
+	    next++;
+	    if (-1 == ece391_pipe (fds)) {
+		ece391_fdputs (out, (uint8_t*)"pipe failed\n");
+		pids[n++] = -1;
+		cmd = 0;
+		break;
+	    }
+	    ece391_dup2 (fds[1], 1);
+	    ece391_close (fds[1]);
+	} else {
+	    next = 0;
+	    ece391_dup2 (out, 1);
+	}
+	if (-1 == (pids[n] = ece391_spawn (cmd)))
+	    ece391_fdputs (out, (uint8_t*)"no such command\n");
+	/* the next command reads this one's pipe; the shell drops its ends */
+	if (0 != next) {
+	    ece391_dup2 (fds[0], 0);
+	    ece391_close (fds[0]);
+	}
+    }
+    if (0 != cmd)
+	ece391_fdputs (out, (uint8_t*)"too many commands in pipeline\n");
+    ece391_dup2 (in, 0);
+    ece391_dup2 (out, 1);
+    ece391_close (in);
+    ece391_close (out);
+
+    rval = -1;
+    for (i = 0; i < n; i++) {
+	if (-1 != pids[i] && -1 != ece391_wait (pids[i], &status, 0))
+	    rval = status;
+	else
+	    rval = -1;
+    }
+    return rval;
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, pid, status;
     uint8_t buf[BUFSIZE];
+    uint8_t* bar;
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+	/* report background jobs that finished since the last prompt */
+	while (0 < (pid = ece391_wait (-1, &status, WAIT_NOHANG))) {
+	    ece391_fdputs (1, (uint8_t*)"[");
+	    ece391_fdputs (1, ece391_itoa (pid, buf, 10));
+	    ece391_fdputs (1, (uint8_t*)"] done\n");
+	}
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -24,6 +95,28 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
+	/* commands joined with | run together, connected by pipes */
+	for (bar = buf; '\0' != *bar && '|' != *bar; bar++);
+	if ('|' == *bar) {
+	    rval = run_pipeline (buf);
+	    if (256 == rval)
+		ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
+	    else if (-1 != rval && 0 != rval)
+		ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+	    continue;
+	}
+	/* a trailing & runs the command in the background */
+	if (cnt > 0 && '&' == buf[cnt - 1]) {
+	    buf[cnt - 1] = '\0';
+	    if (-1 == (pid = ece391_spawn (buf))) {
+		ece391_fdputs (1, (uint8_t*)"no such command\n");
+	    } else {
+		ece391_fdputs (1, (uint8_t*)"[");
+		ece391_fdputs (1, ece391_itoa (pid, buf, 10));
+		ece391_fdputs (1, (uint8_t*)"]\n");
+	    }
+	    continue;
+	}
 	rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
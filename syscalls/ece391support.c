@@ -102,3 +102,20 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+uint64_t ece391_clock_ns(void)
+{
+    volatile ece391_vdso_t* vdso = (volatile ece391_vdso_t*)VDSO_ADDR;
+    uint32_t seq, mult, base, lo, hi;
+    uint64_t ns;
+
+    /* nanoseconds at the last tick plus the TSC cycles since, read without a syscall */
+    do {
+        seq = vdso->seq;
+        ns = vdso->ns_base;
+        mult = vdso->tsc_mult;
+        base = vdso->tsc_base;
+        asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    } while ((seq & 1) || seq != vdso->seq);
+
+    return ns + (((uint64_t)(lo - base) * mult) >> VDSO_MULT_SHIFT);
+}
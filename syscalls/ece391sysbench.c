@@ -0,0 +1,47 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "ece391sysnum.h"
+
+#define CALLS 10000
+
+/* low half of the time stamp counter, runs are short enough not to wrap twice */
+static uint32_t
+tsc (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+static void
+report (const char* name, uint32_t cycles)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, ece391_itoa (cycles / CALLS, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+}
+
+int main ()
+{
+    int32_t i;
+    uint32_t start, fast, slow;
+
+    /* set_handler returns at once, so this times just getting in and out */
+    start = tsc ();
+    for (i = 0; i < CALLS; i++)
+	ece391_set_handler (0, 0);
+    fast = tsc () - start;
+
+    start = tsc ();
+    for (i = 0; i < CALLS; i++)
+	ece391_int80 (SYS_SET_HANDLER, 0, 0, 0);
+    slow = tsc () - start;
+
+    report ("sysenter: ", fast);
+    report ("int 0x80: ", slow);
+    return 0;
+}
@@ -22,6 +22,165 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * Maps an open file read-only into the caller's address space and
+ * returns its length.  Only one file is mapped at a time; mapping
+ * another file or closing fd removes the mapping.
+ */
+extern int32_t ece391_mmap (int32_t fd, uint8_t** start);
+
+/*
+ * fork copies the caller; it returns the child's id to the parent and
+ * 0 to the child.  spawn starts a program without waiting for it and
+ * returns its id.  wait collects a forked or spawned child (pid -1 for
+ * any), storing its exit status; with WAIT_NOHANG it returns 0 instead
+ * of sleeping when no child has finished.
+ */
+#define WAIT_NOHANG 1
+extern int32_t ece391_fork (void);
+extern int32_t ece391_spawn (const uint8_t* command);
+extern int32_t ece391_wait (int32_t pid, int32_t* status, int32_t options);
+
+/*
+ * Opens a regular file for reading and writing, creating it if it does
+ * not exist.  CREATE_TRUNC empties the file, CREATE_APPEND starts writing
+ * at its end.  CREATE_TRUNC fails while a program has the file mapped.
+ */
+#define CREATE_TRUNC 1
+#define CREATE_APPEND 2
+extern int32_t ece391_create (const uint8_t* filename, int32_t flags);
+
+/*
+ * Vectored read and write: fill or send up to IOV_MAX buffers, in order,
+ * with one call.  They return the total number of bytes moved.
+ */
+#define IOV_MAX 16
+typedef struct iovec_t {
+    void* base;
+    int32_t len;
+} iovec_t;
+extern int32_t ece391_readv (int32_t fd, iovec_t* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, iovec_t* iov, int32_t iovcnt);
+
+/*
+ * Batched calls.  ring_setup empties the caller's ring and returns its
+ * address.  Fill sq[sq_tail % RING_ENTRIES] and advance sq_tail for each
+ * request, then ring_enter runs them all in order with one trap and
+ * returns how many it ran.  Each gets a completion at cq[cq_head %
+ * RING_ENTRIES] carrying its user_data and the call's return value;
+ * advance cq_head after reading it.  The opcodes take the same
+ * arguments as the matching calls.
+ */
+#define RING_ENTRIES 64
+#define RING_OP_READ 3
+#define RING_OP_WRITE 4
+#define RING_OP_OPEN 5
+#define RING_OP_CLOSE 6
+#define RING_OP_READV 16
+#define RING_OP_WRITEV 17
+typedef struct ring_sqe_t {
+    int32_t opcode;
+    int32_t arg1;
+    int32_t arg2;
+    int32_t arg3;
+    uint32_t user_data;
+} ring_sqe_t;
+typedef struct ring_cqe_t {
+    uint32_t user_data;
+    int32_t result;
+} ring_cqe_t;
+typedef struct syscall_ring_t {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    ring_sqe_t sq[RING_ENTRIES];
+    ring_cqe_t cq[RING_ENTRIES];
+} syscall_ring_t;
+extern int32_t ece391_ring_setup (syscall_ring_t** ring);
+extern int32_t ece391_ring_enter (void);
+
+/*
+ * Device control.  IOCTL_TERM_MODE on fd 0 takes the TERM_ flags or'd
+ * together and returns the ones it replaced; 0 is edited line input.
+ * With TERM_RAW, reads return whole key_event_t records for every press
+ * and release, without echo.  With TERM_NONBLOCK, reads return 0 at once
+ * when nothing was typed.  The terminal goes back to line input when the
+ * program halts.  IOCTL_TERM_GET returns the flags without changing them;
+ * it fails when fd 0 is not the terminal.
+ */
+#define IOCTL_TERM_MODE 1
+#define IOCTL_TERM_GET 2
+#define TERM_RAW 1
+#define TERM_NONBLOCK 2
+#define KEY_RELEASED 0x01
+#define KEY_SHIFT 0x02
+#define KEY_CTRL 0x04
+#define KEY_ALT 0x08
+#define KEY_CAPS 0x10
+typedef struct key_event_t {
+    uint8_t scancode;
+    uint8_t ch;
+    uint8_t flags;
+    uint8_t pad;
+} key_event_t;
+extern int32_t ece391_ioctl (int32_t fd, int32_t request, int32_t arg);
+
+/*
+ * Waits until one of up to POLL_MAX fds can be read (POLLIN) or written
+ * (POLLOUT) without sleeping, or for timeout PIT ticks (50 per second;
+ * -1 waits for ever, 0 only looks).  Sets revents in each entry and
+ * returns how many have any, 0 on timeout.  An rtc fd is readable once
+ * its next interrupt after the last read has passed.
+ */
+#define POLL_MAX 8
+#define POLLIN 1
+#define POLLOUT 2
+#define POLLNVAL 4
+typedef struct pollfd_t {
+    int32_t fd;
+    uint16_t events;
+    uint16_t revents;
+} pollfd_t;
+extern int32_t ece391_poll (pollfd_t* fds, int32_t nfds, int32_t timeout);
+
+/*
+ * pipe opens a kernel buffer as two fds: fds[0] reads what is written
+ * into fds[1].  Reads sleep while it is empty and return 0 once every
+ * write end is closed; writes sleep while it is full and fail once every
+ * read end is closed.  dup2 closes newfd and makes it a copy of oldfd
+ * (newfd -1 takes the lowest free fd) and returns it.  Programs started
+ * with execute or spawn get copies of the caller's fds 0 and 1.  close
+ * works on fds 0 and 1 once they hold a pipe or file, which lets a
+ * program send end of file before it halts; the terminal stays open.
+ */
+extern int32_t ece391_pipe (int32_t fds[2]);
+extern int32_t ece391_dup2 (int32_t oldfd, int32_t newfd);
+
+/*
+ * The calls above enter the kernel with SYSENTER.  ece391_int80 makes
+ * call number num through the older INT $0x80 gate instead.
+ */
+extern int32_t ece391_int80 (int32_t num, int32_t arg1, int32_t arg2, int32_t arg3);
+
+/*
+ * The kernel keeps a read-only time page at VDSO_ADDR in every program.
+ * seq is odd while the kernel updates it; copy what you need and read
+ * again if seq was odd or changed.  ece391_clock_ns does this for the
+ * nanosecond clock.
+ */
+#define VDSO_ADDR 0x9C00000
+#define VDSO_MULT_SHIFT 24
+typedef struct ece391_vdso_t {
+    uint32_t seq;
+    uint32_t pit_ticks;
+    uint32_t rtc_ticks;
+    uint32_t display_terminal;
+    uint32_t tsc_mult;
+    uint32_t tsc_base;
+    uint64_t ns_base;
+} ece391_vdso_t;
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
@@ -11,5 +11,18 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_MMAP    11
+#define SYS_FORK    12
+#define SYS_SPAWN   13
+#define SYS_WAIT    14
+#define SYS_CREATE  15
+#define SYS_READV   16
+#define SYS_WRITEV  17
+#define SYS_RING_SETUP 18
+#define SYS_RING_ENTER 19
+#define SYS_IOCTL   20
+#define SYS_POLL    21
+#define SYS_PIPE    22
+#define SYS_DUP2    23
 
 #endif /* ECE391SYSNUM_H */